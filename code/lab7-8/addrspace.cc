@@ -44,7 +44,7 @@ SwapHeader (NoffHeader *noffH)
 	noffH->uninitData.inFileAddr = WordToHost(noffH->uninitData.inFileAddr);
 }
 
-BitMap* AddrSpace::pageMap = new BitMap(NumPhysPages);
+BitMap* AddrSpace::pageMap = NULL;	// made once -mem has been seen
 BitMap* AddrSpace::pidMap = new BitMap(MAX_USERPROCESSES);
 
 //----------------------------------------------------------------------
@@ -84,7 +84,7 @@ AddrSpace::AddrSpace(OpenFile *executable)
     numPages = divRoundUp(size, PageSize);
     size = numPages * PageSize;
 
-    ASSERT(numPages <= NumPhysPages);		// check we're not trying
+    ASSERT(numPages <= (unsigned) NumPhysPages);	// check we're not trying
 						// to run anything too big --
 						// at least until we have
 						// virtual memory
@@ -92,6 +92,8 @@ AddrSpace::AddrSpace(OpenFile *executable)
     DEBUG('a', "Initializing address space, num pages %d, size %d\n", 
 					numPages, size);
     
+    if (pageMap == NULL)
+	pageMap = new BitMap(NumPhysPages);
     ASSERT(numPages <= pageMap->NumClear());
 
 // first, set up the translation 
@@ -203,6 +205,7 @@ void AddrSpace::RestoreState()
 {
     machine->pageTable = pageTable;
     machine->pageTableSize = numPages;
+    machine->FlushHostTLB();
 }
 
 void AddrSpace::Print() {
@@ -18,6 +18,7 @@
 #include "copyright.h"
 #include "system.h"
 #include "addrspace.h"
+#include "synch.h"
 #include "noff.h"
 
 #define MAX_USERPROCESSES 256
@@ -44,116 +45,740 @@ SwapHeader (NoffHeader *noffH)
 	noffH->uninitData.inFileAddr = WordToHost(noffH->uninitData.inFileAddr);
 }
 
-BitMap* AddrSpace::pageMap = new BitMap(NumPhysPages);
+FrameAllocator* AddrSpace::freeFrames = NULL;
 BitMap* AddrSpace::pidMap = new BitMap(MAX_USERPROCESSES);
+FrameInfo* AddrSpace::frameTable = NULL;
+PageReplacer* AddrSpace::replacer = NULL;
+Lock* AddrSpace::pagerLock = new Lock("pager");
+SwapSpace* AddrSpace::swap = NULL;
+TextSegment* AddrSpace::textSegments = NULL;
+int AddrSpace::committedPages = 0;
+
+//----------------------------------------------------------------------
+// BackingPages
+// 	Return how many pages memory and the swap space can hold between
+//	them, if every swap file can be created.
+//----------------------------------------------------------------------
+
+static int
+BackingPages()
+{
+    return NumPhysPages + NumSwapFiles * SwapFilePages;
+}
+
+//----------------------------------------------------------------------
+// TextSegment::TextSegment
+// 	Start keeping track of the "nPages" pages of code of the
+//	executable whose file header is at "hdrSector".  None of them is
+//	in memory yet.
+//
+//	An executable is known only by its sector, so it must not be
+//	rewritten while a program is running it.
+//----------------------------------------------------------------------
+
+TextSegment::TextSegment(int hdrSector, int nPages)
+{
+    sector = hdrSector;
+    numPages = nPages;
+    frames = new int[numPages];
+    for (int i = 0; i < numPages; i++)
+	frames[i] = -1;
+    refCount = 0;
+    next = NULL;
+}
+
+TextSegment::~TextSegment()
+{
+    delete [] frames;
+}
 
 //----------------------------------------------------------------------
 // AddrSpace::AddrSpace
 // 	Create an address space to run a user program.
-//	Load the program from a file "executable", and set everything
-//	up so that we can start executing user instructions.
+//	Read the header of the program in the file "executable", and set
+//	up an empty page table for it, so that we can start executing user
+//	instructions.
 //
 //	Assumes that the object code file is in NOFF format.
 //
-//	First, set up the translation from program memory to physical 
-//	memory.  For now, this is really simple (1:1), since we are
-//	only uniprogramming, and we have a single unsegmented page table
+//	No page is loaded yet: each starts out invalid, and is read from
+//	the executable (or zero-filled, for uninitialized data, the heap
+//	and the stack) by HandlePageFault the first time it is touched.
+//	So the address space keeps "executable" open, and closes it when
+//	it is deallocated.
+//
+//	The page table has room for the heap and the stack to grow to
+//	their limits, UserHeapLimit and UserStackLimit; it costs nothing
+//	but page table entries until the pages are used.  The heap starts
+//	out empty, and the stack as the top page.
 //
-//	"executable" is the file containing the object code to load into memory
+//	Room in memory and swap is set aside for the program and for all
+//	the stack it may use; Sbrk sets aside room for the heap as it
+//	grows.  A program is run even if that overcommits, since there is
+//	no way to fail here; Sbrk just fails until enough room is freed.
+//
+//	"execFile" is the file containing the object code to load into memory
 //----------------------------------------------------------------------
 
-AddrSpace::AddrSpace(OpenFile *executable)
+AddrSpace::AddrSpace(OpenFile *execFile)
 {
     ASSERT(pidMap->NumClear() >= 1);    // remain empty pid for use
     spaceId = pidMap->Find() + 100;     // 0-99 for kernel thread
     printf("spaceId = %d\n", spaceId);
 
-    NoffHeader noffH;
-    unsigned int i, size;
+    unsigned int i, size, dataPages;
 
-    executable->ReadAt((char *)&noffH, sizeof(noffH), 0);
-    if ((noffH.noffMagic != NOFFMAGIC) && 
-		(WordToHost(noffH.noffMagic) == NOFFMAGIC))
-    	SwapHeader(&noffH);
-    ASSERT(noffH.noffMagic == NOFFMAGIC);
+    executable = execFile;
+    noffH = new NoffHeader;
+    executable->ReadAt((char *)noffH, sizeof(NoffHeader), 0);
+    if ((noffH->noffMagic != NOFFMAGIC) && 
+		(WordToHost(noffH->noffMagic) == NOFFMAGIC))
+    	SwapHeader(noffH);
+    ASSERT(noffH->noffMagic == NOFFMAGIC);
 
 // how big is address space?
-    size = noffH.code.size + noffH.initData.size + noffH.uninitData.size 
-			+ UserStackSize;	// we need to increase the size
-						// to leave room for the stack
-    numPages = divRoundUp(size, PageSize);
+    size = noffH->code.size + noffH->initData.size + noffH->uninitData.size;
+    dataPages = divRoundUp(size, PageSize);
+    heapBase = brk = dataPages * PageSize;
+    stackBase = dataPages + divRoundUp(UserHeapLimit, PageSize);
+    numPages = stackBase + divRoundUp(UserStackLimit, PageSize);
+    stackLow = numPages - 1;
+    numCommitted = dataPages + divRoundUp(UserStackLimit, PageSize);
+    committedPages += numCommitted;
     size = numPages * PageSize;
 
-    ASSERT(numPages <= NumPhysPages);		// check we're not trying
-						// to run anything too big --
-						// at least until we have
-						// virtual memory
-
     DEBUG('a', "Initializing address space, num pages %d, size %d\n", 
 					numPages, size);
-    
-    ASSERT(numPages <= pageMap->NumClear());
 
-// first, set up the translation 
+// set up the translation; every page is brought in on demand
     pageTable = new TranslationEntry[numPages];
+    swapSlot = new int[numPages];
+    copyOnWrite = new bool[numPages];
     for (i = 0; i < numPages; i++) {
-	pageTable[i].virtualPage = i;	// for now, virtual page # = phys page #
-	pageTable[i].physicalPage = pageMap->Find();
-	pageTable[i].valid = TRUE;
+	pageTable[i].virtualPage = i;
+	pageTable[i].physicalPage = -1;	// not in memory yet
+	pageTable[i].valid = FALSE;
 	pageTable[i].use = FALSE;
 	pageTable[i].dirty = FALSE;
-	pageTable[i].readOnly = FALSE;  // if the code segment was entirely on 
-					// a separate page, we could set its 
-					// pages to be read-only
-    }
-    
-// zero out the entire address space, to zero the unitialized data segment 
-// and the stack segment
-    //bzero(machine->mainMemory, size);
-
-// then, copy in the code and data segments into memory
-    if (noffH.code.size > 0) {
-        DEBUG('a', "Initializing code segment, at 0x%x, size %d\n", 
-			noffH.code.virtualAddr, noffH.code.size);
-        int position = pageTable[noffH.code.virtualAddr / PageSize].physicalPage * PageSize;
-        int offset = noffH.code.virtualAddr % PageSize;
-        executable->ReadAt(&(machine->mainMemory[position + offset]),
-			noffH.code.size, noffH.code.inFileAddr);
-    }
-    if (noffH.initData.size > 0) {
-        DEBUG('a', "Initializing data segment, at 0x%x, size %d\n", 
-			noffH.initData.virtualAddr, noffH.initData.size);
-        int position = pageTable[noffH.initData.virtualAddr / PageSize].physicalPage * PageSize;
-        int offset = noffH.initData.virtualAddr % PageSize;
-        executable->ReadAt(&(machine->mainMemory[position + offset]),
-			noffH.initData.size, noffH.initData.inFileAddr);
+	pageTable[i].readOnly = FALSE;  // set for code pages, when they
+					// are loaded
+	swapSlot[i] = -1;		// nothing in swap yet
+	copyOnWrite[i] = FALSE;
     }
+    pagerLock->Acquire();
+    AttachText(executable->HeaderSector());
+    pagerLock->Release();
 #ifdef FILESYS
-    for(int i = 3; i < 10; i++) fileDescriptor[i] = NULL;
-    OpenFile *StdinFile = new OpenFile("stdin");
-    OpenFile *StdoutFile = new OpenFile("stdout");
-    OpenFile *StderrFile = new OpenFile("stderr");
-    /* 输出、输入、错误 */
-    fileDescriptor[0] = StdinFile;
-    fileDescriptor[1] = StdoutFile;
-    fileDescriptor[2] = StderrFile;
+    InitFileDescriptors();
+#endif
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::AddrSpace
+// 	Create a copy of the address space "parent", for a forked process.
+//
+//	Nothing is copied yet.  The clone shares the parent's frames and
+//	swap slots, and the pages that can be written are made read-only
+//	in both page tables; the first write to one raises a
+//	ReadOnlyException, and HandleWriteFault gives the writer its own
+//	copy.  Pages that aren't loaded yet are loaded separately by each
+//	address space, from the executable, which the clone opens again.
+//
+//	Open files are not inherited: the clone gets its own stdin, stdout
+//	and stderr, as a new program does.
+//----------------------------------------------------------------------
+
+AddrSpace::AddrSpace(AddrSpace *parent)
+{
+    unsigned int i;
+
+    ASSERT(pidMap->NumClear() >= 1);    // remain empty pid for use
+    spaceId = pidMap->Find() + 100;     // 0-99 for kernel thread
+    printf("spaceId = %d\n", spaceId);
+
+    executable = new OpenFile(parent->executable->HeaderSector());
+    noffH = new NoffHeader;
+    *noffH = *parent->noffH;
+    numPages = parent->numPages;
+    heapBase = parent->heapBase;
+    brk = parent->brk;
+    stackBase = parent->stackBase;
+    stackLow = parent->stackLow;
+    numCommitted = parent->numCommitted;	// the clone's pages may all
+    committedPages += numCommitted;		// end up copied
+    DEBUG('a', "Cloning address space %d as %d, num pages %d\n",
+					parent->spaceId, spaceId, numPages);
+
+    pageTable = new TranslationEntry[numPages];
+    swapSlot = new int[numPages];
+    copyOnWrite = new bool[numPages];
+    pagerLock->Acquire();		// so no page moves while we copy
+    text = parent->text;
+    text->refCount++;
+    for (i = 0; i < numPages; i++) {
+	pageTable[i] = parent->pageTable[i];
+	pageTable[i].use = FALSE;
+	swapSlot[i] = parent->swapSlot[i];
+	if (swapSlot[i] >= 0)
+	    swap->Share(swapSlot[i]);
+	copyOnWrite[i] = FALSE;
+	if (!pageTable[i].valid)
+	    continue;
+	frameTable[pageTable[i].physicalPage].AddMapping(this, i, 
+							&pageTable[i]);
+	if (!pageTable[i].readOnly || parent->copyOnWrite[i]) {
+	    pageTable[i].readOnly = parent->pageTable[i].readOnly = TRUE;
+	    copyOnWrite[i] = parent->copyOnWrite[i] = TRUE;
+	}
+    }
+    machine->FlushHostTLB();		// the parent can't write them now
+    pagerLock->Release();
+#ifdef FILESYS
+    InitFileDescriptors();
 #endif
 }
 
 //----------------------------------------------------------------------
 // AddrSpace::~AddrSpace
-// 	Dealloate an address space.  Nothing for now!
+// 	Dealloate an address space: let go of its frames and swap slots,
+//	which are freed unless a clone still shares them, and close the
+//	executable.
 //----------------------------------------------------------------------
 
 AddrSpace::~AddrSpace()
 {
     pidMap->Clear(spaceId - 100);
-    for(int i = 0; i < numPages; i++) {
-        pageMap->Clear(pageTable[i].physicalPage);
-    }
+    pagerLock->Acquire();
+    for(int i = 0; i < numPages; i++)
+        ReleasePage(i);
+    DetachText();
+    pagerLock->Release();
+    committedPages -= numCommitted;
     delete [] pageTable;
+    delete [] swapSlot;
+    delete [] copyOnWrite;
+    delete noffH;
+    delete executable;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::HandlePageFault
+// 	Called on a PageFaultException, to bring the page containing
+//	"badVAddr" into memory; the faulting instruction is then retried.
+//	If memory is full, some page (perhaps of another address space)
+//	is evicted to make room.
+//
+//	Page faults are handled one at a time, since a thread may block
+//	on the disk in the middle of one.  The page may have been brought
+//	in by another thread sharing this address space while we waited.
+//
+//	A fault below the stack is how the stack grows: if it is at or
+//	above the stack pointer, and no lower than UserStackLimit allows,
+//	the stack now reaches down to its page.  The pages in between
+//	start out zero, like the rest.
+//
+//	Returns FALSE if "badVAddr" is not in the address space at all, or
+//	is between the break and the stack, and not a place it can grow to;
+//	or if there is no room for the page, in memory or in swap.
+//----------------------------------------------------------------------
+
+bool
+AddrSpace::HandlePageFault(int badVAddr)
+{
+    unsigned int vpn = (unsigned) badVAddr / PageSize;
+
+    if (!IsMapped(vpn)) {
+	if (vpn < stackBase || vpn >= numPages
+			|| badVAddr < machine->ReadRegister(StackReg))
+	    return FALSE;
+	DEBUG('a', "Growing the stack of space %d down to page %d\n",
+							spaceId, vpn);
+	stackLow = vpn;
+    }
+    pagerLock->Acquire();
+    if (!pageTable[vpn].valid) {
+	DEBUG('a', "Page fault on page %d of space %d\n", vpn, spaceId);
+	stats->numPageFaults++;
+	if (IsTextPage(vpn) && text->frames[vpn] >= 0) {
+	    int frame = text->frames[vpn];	// another space loaded it
+
+	    DEBUG('a', "Sharing code in frame %d\n", frame);
+	    frameTable[frame].AddMapping(this, vpn, &pageTable[vpn]);
+	    pageTable[vpn].physicalPage = frame;
+	    pageTable[vpn].use = FALSE;
+	    pageTable[vpn].dirty = FALSE;
+	    pageTable[vpn].readOnly = TRUE;
+	    copyOnWrite[vpn] = FALSE;
+	    pageTable[vpn].valid = TRUE;
+	} else {			// a page that starts out zero
+	    int frame = AllocateFrame(swapSlot[vpn] < 0 && !IsTextPage(vpn));
+
+	    if (frame < 0) {
+		pagerLock->Release();
+		return FALSE;
+	    }
+	    LoadPage(vpn, frame);
+	}
+    }
+    pagerLock->Release();
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::HandleWriteFault
+// 	Called on a ReadOnlyException.  If the page containing "badVAddr"
+//	is copy-on-write, give this address space its own copy, and make
+//	it writable; the faulting instruction is then retried.  If no
+//	other address space still shares the frame, it is simply made
+//	writable.
+//
+//	If the page was evicted while we waited for the pager, there is
+//	nothing to do: retrying will page fault, and load a private copy.
+//
+//	Returns FALSE if the page really is read-only, or if there is no
+//	room for the copy, in memory or in swap.
+//----------------------------------------------------------------------
+
+bool
+AddrSpace::HandleWriteFault(int badVAddr)
+{
+    unsigned int vpn = (unsigned) badVAddr / PageSize;
+    TranslationEntry *entry;
+    bool ok = TRUE;
+    int frame, copy;
+
+    if (vpn >= numPages)
+	return FALSE;
+    entry = &pageTable[vpn];
+    pagerLock->Acquire();
+    if (entry->valid && entry->readOnly) {
+	if (!copyOnWrite[vpn])
+	    ok = FALSE;
+	else {
+	    frame = entry->physicalPage;
+	    if (frameTable[frame].IsShared()) {
+		DEBUG('a', "Copying page %d of space %d\n", vpn, spaceId);
+		stats->numPageCopies++;
+		copy = AllocateFrame(FALSE);
+		if (copy < 0) {
+		    pagerLock->Release();
+		    return FALSE;
+		}
+		if (!entry->valid)	// evicted to make room for the copy
+		    LoadPage(vpn, copy);
+		else {
+		    bcopy(&machine->mainMemory[frame * PageSize],
+			&machine->mainMemory[copy * PageSize], PageSize);
+		    frameTable[frame].RemoveMapping(this, vpn);
+		    frameTable[copy].AddMapping(this, vpn, entry);
+		    entry->physicalPage = copy;
+		    replacer->Loaded(copy);
+		}
+	    }
+	    entry->readOnly = FALSE;
+	    copyOnWrite[vpn] = FALSE;
+	    machine->FlushHostTLB();
+	}
+    }
+    pagerLock->Release();
+    return ok;
 }
 
+//----------------------------------------------------------------------
+// AddrSpace::Sbrk
+// 	Grow the heap by "increment" bytes, or shrink it if "increment" is
+//	negative, and return where it used to end.  New heap pages are
+//	zero-filled when they are first touched; pages the heap no longer
+//	covers are freed, with their frames and swap slots.
+//
+//	When the new break is in the middle of a page, the rest of that
+//	page is zeroed, so that growing the heap again gives back zeroes
+//	and not what was there.  It is written like any user page (which
+//	brings it in, or copies it if it is shared copy-on-write), unless
+//	it has never been used, and so is still zero.  The pager lock
+//	isn't held while writing, since writing may fault.
+//
+//	Returns 0 -- never a heap address, since the code is below it -- if
+//	the heap would end below its start, or reach past UserHeapLimit;
+//	or if memory and swap can't hold the new pages, on top of those
+//	set aside for every address space already.  "increment" is
+//	checked before it is added, so that no value can overflow.
+//----------------------------------------------------------------------
+
+int
+AddrSpace::Sbrk(int increment)
+{
+    int oldBreak = brk, newBreak, pages;
+
+    if (increment < heapBase - brk
+			|| increment > (int) stackBase * PageSize - brk)
+	return 0;
+    newBreak = brk + increment;
+    pages = divRoundUp(newBreak, PageSize) - divRoundUp(oldBreak, PageSize);
+    if (pages > 0 && committedPages + pages > BackingPages()) {
+	DEBUG('a', "No room for %d more heap pages in space %d\n", pages,
+								spaceId);
+	return 0;
+    }
+    numCommitted += pages;		// or gives back, if shrinking
+    committedPages += pages;
+    DEBUG('a', "Moving the break of space %d from 0x%x to 0x%x\n", spaceId,
+					oldBreak, newBreak);
+    if (newBreak < oldBreak) {
+	int lastPage = newBreak / PageSize, span;
+	bool used;
+	char *location;
+
+	pagerLock->Acquire();		// not while it is being paged out
+	used = pageTable[lastPage].valid || swapSlot[lastPage] >= 0;
+	pagerLock->Release();
+	if (newBreak % PageSize != 0 && used) {
+	    location = machine->TranslateSpan(newBreak, TRUE, &span);
+	    if (location != NULL)
+		bzero(location, min(span, oldBreak - newBreak));
+	}
+	pagerLock->Acquire();
+	for (int vpn = divRoundUp(newBreak, PageSize);
+			vpn < divRoundUp(oldBreak, PageSize); vpn++)
+	    ReleasePage(vpn);
+	machine->FlushHostTLB();
+	pagerLock->Release();
+    }
+    brk = newBreak;
+    return oldBreak;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::IsMapped
+// 	Return TRUE if page "vpn" holds part of the program, the heap, or
+//	the stack as far as it has grown.  The pages in between aren't
+//	there.
+//----------------------------------------------------------------------
+
+bool
+AddrSpace::IsMapped(unsigned int vpn)
+{
+    if (vpn >= numPages)
+	return FALSE;
+    return (int) (vpn * PageSize) < brk || vpn >= stackLow;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::ReleasePage
+// 	Take page "vpn" out of the address space: let go of its frame and
+//	its swap slot, each freed unless a clone still shares it.  If the
+//	page is used again, it starts out zero.  Called with the pager
+//	lock held.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::ReleasePage(int vpn)
+{
+    if (pageTable[vpn].valid) {
+	int frame = pageTable[vpn].physicalPage;
+
+	frameTable[frame].RemoveMapping(this, vpn);
+	if (frameTable[frame].IsFree())
+	    FreeFrame(frame, vpn);
+	pageTable[vpn].valid = FALSE;
+    }
+    if (swapSlot[vpn] >= 0) {
+	swap->Free(swapSlot[vpn]);
+	swapSlot[vpn] = -1;
+    }
+    pageTable[vpn].readOnly = FALSE;
+    copyOnWrite[vpn] = FALSE;
+}
+
+//----------------------------------------------------------------------
+// ZeroFreeFrames
+// 	Called when the machine is idle, to zero a few free frames ahead
+//	of time, so that page faults on pages that start out zero don't
+//	have to.
+//
+//	"arg" -- the FrameAllocator
+//----------------------------------------------------------------------
+
+static void
+ZeroFreeFrames(_int arg)
+{
+    FrameAllocator *frames = (FrameAllocator *) arg;
+
+    for (int i = 0; i < ZeroBatch && frames->ZeroFrame(); i++)
+	stats->numIdleZeroFills++;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::InitPaging
+// 	Create the frame table and the free frame stacks, now that the
+//	size of physical memory is known, and the page replacer for
+//	"policy".  Free frames are zeroed when the machine is idle.
+//	Called once, when Nachos starts up.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::InitPaging(ReplacementPolicy policy)
+{
+    ASSERT(frameTable == NULL);
+    frameTable = new FrameInfo[NumPhysPages];
+    freeFrames = new FrameAllocator(NumPhysPages);
+    replacer = NewPageReplacer(policy, frameTable, NumPhysPages);
+    interrupt->AddIdleHandler(ZeroFreeFrames, (_int) freeFrames);
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::AllocateFrame
+// 	Return a free frame of physical memory.  If there are none, ask
+//	the replacement policy for a frame, and evict the page in it.
+//	Return -1 if that page has to be saved, and the swap space is
+//	full; the frame stays as it is.
+//
+//	"wantZero" -- TRUE if the page to go in the frame starts out
+//		zero, so a frame zeroed while the machine was idle will do
+//----------------------------------------------------------------------
+
+int
+AddrSpace::AllocateFrame(bool wantZero)
+{
+    int frame = freeFrames->Allocate(wantZero);
+
+    if (frame >= 0)
+	return frame;
+    frame = replacer->ChooseVictim();
+    if (!EvictFrame(frame)) {
+	replacer->Loaded(frame);	// so the policy still knows of it
+	return -1;
+    }
+    return freeFrames->Allocate(wantZero);	// the frame EvictFrame
+						// just freed
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::EvictFrame
+// 	Take the pages in "frame" out of memory, and free the frame.  If
+//	they were modified, the frame is written to the swap space first;
+//	otherwise their contents can be found again where they came from
+//	-- the executable, their swap slot, or nothing at all
+//	(zero-filled).
+//
+//	The pages sharing a frame are all clean or all dirty, since they
+//	were cloned from one page and none of them can be written.  A
+//	page writes back to its own slot, unless a clone still shares the
+//	old contents there; then the frame goes to a new slot, shared by
+//	all its pages.
+//
+//	Returns FALSE, leaving the frame alone, if a new slot is needed
+//	and the swap space is full.  The slot is found before the pages
+//	are taken out, so there is nothing to undo.
+//----------------------------------------------------------------------
+
+bool
+AddrSpace::EvictFrame(int frame)
+{
+    FrameInfo *info = &frameTable[frame];
+    FrameMapping *m;
+    bool dirty = info->Dirty();
+    int slot, vpn;
+
+    if (dirty) {
+	m = info->mappings;
+	slot = m->space->swapSlot[m->virtualPage];
+	if (info->IsShared() || slot < 0 || swap->IsShared(slot)) {
+	    if (swap == NULL)
+		swap = new SwapSpace;
+	    slot = swap->Allocate();
+	    if (slot < 0) {
+		printf("Out of swap space.\n");
+		return FALSE;
+	    }
+	    for (; m != NULL; m = m->next) {
+		if (m->space->swapSlot[m->virtualPage] >= 0)
+		    swap->Free(m->space->swapSlot[m->virtualPage]);
+		m->space->swapSlot[m->virtualPage] = slot;
+		swap->Share(slot);
+	    }
+	    swap->Free(slot);		// drop the reference from Allocate
+	}
+    }
+    DEBUG('a', "Evicting frame %d, holding %d pages\n", frame, 
+					info->numMappings);
+    for (m = info->mappings; m != NULL; m = m->next)
+	m->entry->valid = FALSE;	// before we might block on the disk
+    machine->FlushHostTLB();		// in case their space is running
+    stats->numPageEvictions++;
+    if (dirty) {
+	swap->WritePage(slot, &machine->mainMemory[frame * PageSize]);
+	stats->numPageOuts++;
+	for (m = info->mappings; m != NULL; m = m->next)
+	    m->entry->dirty = FALSE;
+    }
+    vpn = info->mappings->virtualPage;
+    while (info->mappings != NULL)
+	info->RemoveMapping(info->mappings->space, 
+					info->mappings->virtualPage);
+    FreeFrame(frame, vpn);
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::FreeFrame
+// 	Mark "frame" free, now that no page is in it.  If it held code,
+//	it no longer does.
+//
+//	"vpn" -- the page that was last in the frame
+//----------------------------------------------------------------------
+
+void
+AddrSpace::FreeFrame(int frame, int vpn)
+{
+    if (frameTable[frame].text != NULL) {
+	frameTable[frame].text->frames[vpn] = -1;
+	frameTable[frame].text = NULL;
+    }
+    freeFrames->Free(frame);
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::AttachText
+// 	Find the record of the frames holding the code of the executable
+//	whose file header is at "sector", creating it if no other address
+//	space is running that executable.  Called with the pager lock held.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::AttachText(int sector)
+{
+    for (text = textSegments; text != NULL; text = text->next)
+	if (text->sector == sector)
+	    break;
+    if (text == NULL) {
+	text = new TextSegment(sector,
+		(noffH->code.virtualAddr + noffH->code.size) / PageSize);
+	text->next = textSegments;
+	textSegments = text;
+    }
+    text->refCount++;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::DetachText
+// 	Stop sharing the code of our executable; once no address space
+//	is running it, forget it.  Our pages must already be out of
+//	memory.  Called with the pager lock held.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::DetachText()
+{
+    TextSegment **prev;
+
+    if (--text->refCount > 0)
+	return;
+    for (prev = &textSegments; *prev != text; prev = &(*prev)->next)
+	;
+    *prev = text->next;
+    delete text;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::IsTextPage
+// 	Return TRUE if page "vpn" holds nothing but code.  Such a page is
+//	never written, so it is read-only, and shared by every address
+//	space running the same executable.
+//----------------------------------------------------------------------
+
+bool
+AddrSpace::IsTextPage(int vpn)
+{
+    return vpn * PageSize >= noffH->code.virtualAddr && vpn < text->numPages;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::LoadPage
+// 	Bring page "vpn" into the free frame "frame": from the swap space
+//	if it was swapped out, and otherwise from the code and initialized
+//	data segments of the executable, zero-filling the rest.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::LoadPage(int vpn, int frame)
+{
+    char *page = &machine->mainMemory[frame * PageSize];
+
+    frameTable[frame].AddMapping(this, vpn, &pageTable[vpn]);
+					// claim the frame before we might
+					// block on the disk
+    if (swapSlot[vpn] >= 0)
+	swap->ReadPage(swapSlot[vpn], page);
+    else {
+	if (!IsTextPage(vpn) && !freeFrames->IsZeroed(frame)) {
+	    bzero(page, PageSize);	// code fills the whole page, and
+	    stats->numZeroFills++;	// a zeroed frame needs nothing
+	}
+	LoadSegment(page, vpn, noffH->code.virtualAddr, 
+			noffH->code.inFileAddr, noffH->code.size);
+	LoadSegment(page, vpn, noffH->initData.virtualAddr, 
+			noffH->initData.inFileAddr, noffH->initData.size);
+    }
+    pageTable[vpn].physicalPage = frame;
+    pageTable[vpn].use = FALSE;
+    pageTable[vpn].dirty = FALSE;
+    pageTable[vpn].readOnly = IsTextPage(vpn);	// writable pages are no
+    copyOnWrite[vpn] = FALSE;			// longer shared with a clone
+    pageTable[vpn].valid = TRUE;
+    if (IsTextPage(vpn)) {
+	text->frames[vpn] = frame;
+	frameTable[frame].text = text;
+    }
+    replacer->Loaded(frame);
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::LoadSegment
+// 	Read the part of a segment of the executable that falls in page
+//	"vpn" into "page", the frame it is being loaded into.
+//
+//	"virtualAddr", "inFileAddr", "size" -- describe the segment
+//----------------------------------------------------------------------
+
+void
+AddrSpace::LoadSegment(char *page, int vpn, int virtualAddr, int inFileAddr,
+								int size)
+{
+    int start = vpn * PageSize, end = start + PageSize;
+
+    if (virtualAddr > start)
+	start = virtualAddr;
+    if (virtualAddr + size < end)
+	end = virtualAddr + size;
+    if (start >= end)
+	return;				// segment isn't in this page
+    DEBUG('a', "Loading %d bytes at 0x%x\n", end - start, start);
+    executable->ReadAt(page + (start - vpn * PageSize), end - start,
+					inFileAddr + (start - virtualAddr));
+}
+
+#ifdef FILESYS
+//----------------------------------------------------------------------
+// AddrSpace::InitFileDescriptors
+// 	Open the console as file descriptors 0, 1 and 2; the rest start
+//	out closed.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::InitFileDescriptors()
+{
+    for(int i = 3; i < 10; i++) fileDescriptor[i] = NULL;
+    OpenFile *StdinFile = new OpenFile("stdin");
+    OpenFile *StdoutFile = new OpenFile("stdout");
+    OpenFile *StderrFile = new OpenFile("stderr");
+    /* 输出、输入、错误 */
+    fileDescriptor[0] = StdinFile;
+    fileDescriptor[1] = StdoutFile;
+    fileDescriptor[2] = StderrFile;
+}
+#endif
+
 //----------------------------------------------------------------------
 // AddrSpace::InitRegisters
 // 	Set the initial values for the user-level register set.
@@ -212,6 +837,7 @@ void AddrSpace::RestoreState()
 {
     machine->pageTable = pageTable;
     machine->pageTableSize = numPages;
+    machine->FlushHostTLB();
 }
 
 void AddrSpace::Print() {
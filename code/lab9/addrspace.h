@@ -2,9 +2,20 @@
 //	Data structures to keep track of executing user programs 
 //	(address spaces).
 //
-//	For now, we don't keep any information about address spaces.
-//	The user level CPU state is saved and restored in the thread
-//	executing the user program (see thread.h).
+//	Pages are brought into physical memory on demand, when the
+//	program first touches them, and may later be evicted to make room
+//	for others.  An address space can be cloned; the clone shares its
+//	parent's pages, copy-on-write.  Pages holding nothing but code are
+//	read-only, and are shared by every address space running the same
+//	executable.  The user level CPU state is saved and restored in the
+//	thread executing the user program (see thread.h).
+//
+//	Above the program's data is a heap, which the program grows and
+//	shrinks with Sbrk, and at the top of the address space is the
+//	stack.  The stack starts out one page long, and grows down when
+//	the program faults on a page below it, at or above the stack
+//	pointer, until it reaches UserStackLimit.  Both are demand-zero:
+//	a page only gets a frame once it is used.
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -16,16 +27,42 @@
 #include "copyright.h"
 #include "filesys.h"
 #include "bitmap.h"
+#include "swap.h"
+#include "replace.h"
 
-#define UserStackSize		1024 	// increase this as necessary!
+#define UserStackLimit		4096	// most the stack can grow to
+#define UserHeapLimit		65536	// most the heap can grow to, if
+					// memory and swap can hold it
 
 #define MAX_USERPROCESSES 256
 
+class Lock;
+struct noffHeader;
+
+// The following class records which frames hold the code of one
+// executable, so that every address space running it can share them.
+// An executable is known by the disk sector of its file header.
+
+class TextSegment {
+  public:
+    TextSegment(int sector, int numPages);
+    ~TextSegment();
+
+    int sector;			// the executable's file header sector
+    int numPages;		// number of pages of code
+    int *frames;		// frame holding each page, or -1
+    int refCount;		// address spaces running the executable
+    TextSegment *next;		// next in the list of all of them
+};
+
 class AddrSpace {
   public:
-    AddrSpace(OpenFile *executable);	// Create an address space,
-					// initializing it with the program
-					// stored in the file "executable"
+    AddrSpace(OpenFile *executable);	// Create an address space, to
+					// run the program stored in the
+					// file "executable", which the
+					// address space keeps open
+    AddrSpace(AddrSpace *parent);	// Create a copy of "parent"; pages
+					// are shared until either writes
     ~AddrSpace();			// De-allocate an address space
 
     void InitRegisters();		// Initialize user-level CPU registers,
@@ -34,6 +71,25 @@ class AddrSpace {
     void SaveState();			// Save/restore address space-specific
     void RestoreState();		// info on a context switch 
 
+    bool HandlePageFault(int badVAddr);	// Bring the page containing
+					// "badVAddr" into memory; FALSE if
+					// it is outside the address space,
+					// or there is no room for it
+    bool HandleWriteFault(int badVAddr);
+					// Give this address space its own
+					// copy of a copy-on-write page;
+					// FALSE if the page is read-only,
+					// or there is no room for a copy
+    int Sbrk(int increment);		// Move the end of the heap; return
+					// the old end, or 0 if it can't
+
+    static void InitPaging(ReplacementPolicy policy);
+					// Set up the frame table for the
+					// memory size chosen at boot, and
+					// choose how pages are picked for
+					// eviction; call before running
+					// any user program
+
     void Print();
     unsigned int GetSpaceId() { return spaceId;}
 
@@ -50,8 +106,60 @@ class AddrSpace {
     unsigned int numPages;		// Number of pages in the virtual 
 					// address space
     unsigned int spaceId;
-    static BitMap *pageMap;   // Bitmap of physical page, static for global view for all objects
+    OpenFile *executable;		// where code and initialized data
+					// are paged in from
+    struct noffHeader *noffH;		// where they are in the file
+    int *swapSlot;			// slot in the swap space holding
+					// each page, or -1
+    bool *copyOnWrite;			// is each page read-only only
+					// because it is shared with a clone?
+    TextSegment *text;			// the frames holding our code
+    int heapBase;			// where the heap starts
+    int brk;				// where it ends: the "break"
+    unsigned int stackBase;		// lowest page the stack can grow to
+    unsigned int stackLow;		// lowest page it has grown to
+    int numCommitted;			// pages of memory and swap set
+					// aside for us, in committedPages
+
+    bool IsTextPage(int vpn);		// Does a page hold only code?
+    bool IsMapped(unsigned int vpn);	// Is a page part of the program,
+					// heap or stack?
+    void ReleasePage(int vpn);		// Let go of a page's frame and
+					// swap slot
+    void LoadPage(int vpn, int frame);	// Fill a frame with a page
+    void LoadSegment(char *page, int vpn, int virtualAddr, int inFileAddr,
+								int size);
+					// Read the part of a segment of
+					// the executable that is in a page
+#ifdef FILESYS
+    void InitFileDescriptors();		// Open stdin, stdout and stderr
+#endif
+
+    void AttachText(int sector);	// Start sharing the code of the
+					// executable with header "sector"
+    void DetachText();			// Stop sharing it
+
+    static void FreeFrame(int frame, int vpn);
+					// Mark an empty frame free
+    static bool EvictFrame(int frame);	// Take the pages in a frame out
+					// of memory, saving them in swap
+					// if dirty; FALSE if swap is full
+    static int AllocateFrame(bool wantZero);
+					// Find a free frame, evicting
+					// a page if there is none; -1 if
+					// that can't be done
+
+    static FrameAllocator *freeFrames;	// the free frames of physical
+					// memory, shared by all spaces
     static BitMap *pidMap;
+    static FrameInfo *frameTable;	// what is in each physical frame
+    static PageReplacer *replacer;	// picks frames to evict
+    static Lock *pagerLock;		// one page fault handled at a time
+    static SwapSpace *swap;		// created on the first swap out
+    static TextSegment *textSegments;	// the code of every executable
+					// being run
+    static int committedPages;		// pages of memory and swap set
+					// aside for every address space
 };
 
 #endif // ADDRSPACE_H
@@ -22,8 +22,10 @@ BitMap::BitMap(int nitems)
     numBits = nitems;
     numWords = divRoundUp(numBits, BitsInWord);
     map = new unsigned int[numWords];
-    for (int i = 0; i < numBits; i++) 
-        Clear(i);
+    for (int i = 0; i < numWords; i++) 
+        map[i] = 0;
+    numClear = numBits;
+    MarkPadding();
 }
 
 //----------------------------------------------------------------------
@@ -47,6 +49,8 @@ void
 BitMap::Mark(int which) 
 { 
     ASSERT(which >= 0 && which < numBits);
+    if (!Test(which))
+	numClear--;
     map[which / BitsInWord] |= 1 << (which % BitsInWord);
 }
     
@@ -61,6 +65,8 @@ void
 BitMap::Clear(int which) 
 {
     ASSERT(which >= 0 && which < numBits);
+    if (Test(which))
+	numClear++;
     map[which / BitsInWord] &= ~(1 << (which % BitsInWord));
 }
 
@@ -82,40 +88,82 @@ BitMap::Test(int which)
 	return FALSE;
 }
 
+//----------------------------------------------------------------------
+// FirstZero
+// 	Return the number of the lowest clear bit in "word", which must
+//	have one.  This is the count of trailing ones, which GCC can find
+//	with one instruction on most machines.
+//----------------------------------------------------------------------
+
+static int
+FirstZero(unsigned int word)
+{
+#ifdef __GNUC__
+    return __builtin_ctz(~word);
+#else
+    int bit = 0;
+
+    while (word & 1) {
+	word >>= 1;
+	bit++;
+    }
+    return bit;
+#endif
+}
+
 //----------------------------------------------------------------------
 // BitMap::Find
 // 	Return the number of the first bit which is clear.
 //	As a side effect, set the bit (mark it as in use).
 //	(In other words, find and allocate a bit.)
 //
+//	Words with every bit set are skipped whole.  The bits past
+//	numBits in the last word are always set, so they are never found.
+//
 //	If no bits are clear, return -1.
 //----------------------------------------------------------------------
 
 int 
 BitMap::Find() 
 {
-    for (int i = 0; i < numBits; i++)
-	if (!Test(i)) {
-	    Mark(i);
-	    return i;
+    if (numClear == 0)
+	return -1;
+    for (int i = 0; i < numWords; i++)
+	if (map[i] != ~0U) {
+	    int which = i * BitsInWord + FirstZero(map[i]);
+
+	    Mark(which);
+	    return which;
 	}
+    ASSERT(FALSE);			// numClear was wrong
     return -1;
 }
 
 //----------------------------------------------------------------------
-// BitMap::NumClear
-// 	Return the number of clear bits in the bitmap.
-//	(In other words, how many bits are unallocated?)
+// BitMap::MarkPadding
+// 	Set the bits of the last word that are past the end of the
+//	bitmap.  They aren't counted in numClear.
 //----------------------------------------------------------------------
 
-int 
-BitMap::NumClear() 
+void
+BitMap::MarkPadding()
 {
-    int count = 0;
+    if (numBits % BitsInWord != 0)
+	map[numWords - 1] |= ~0U << (numBits % BitsInWord);
+}
+
+//----------------------------------------------------------------------
+// BitMap::Recount
+// 	Recompute the number of clear bits, after the whole map has been
+//	replaced.
+//----------------------------------------------------------------------
 
+void
+BitMap::Recount()
+{
+    numClear = 0;
     for (int i = 0; i < numBits; i++)
-	if (!Test(i)) count++;
-    return count;
+	if (!Test(i)) numClear++;
 }
 
 //----------------------------------------------------------------------
@@ -149,6 +197,8 @@ void
 BitMap::FetchFrom(OpenFile *file) 
 {
     file->ReadAt((char *)map, numWords * sizeof(unsigned), 0);
+    MarkPadding();
+    Recount();
 }
 
 //----------------------------------------------------------------------
@@ -3,7 +3,9 @@
 //	can be either on or off.
 //
 //	Represented as an array of unsigned integers, on which we do
-//	modulo arithmetic to find the bit we are interested in.
+//	modulo arithmetic to find the bit we are interested in.  Find
+//	looks at a word at a time, and the number of clear bits is kept
+//	up to date as bits change, so neither scans the bits one by one.
 //
 //	The bitmap can be parameterized with with the number of bits being 
 //	managed.
@@ -43,7 +45,8 @@ class BitMap {
     int Find();            	// Return the # of a clear bit, and as a side
 				// effect, set the bit. 
 				// If no bits are clear, return -1.
-    int NumClear();		// Return the number of clear bits
+    int NumClear() { return numClear; }
+				// Return the number of clear bits
 
     void Print();		// Print contents of bitmap
     
@@ -59,6 +62,11 @@ class BitMap {
 					//  multiple of the number of bits in
 					//  a word)
     unsigned int *map;			// bit storage
+    int numClear;			// number of clear bits
+
+    void MarkPadding();			// Set the bits past numBits, so
+					// that Find never returns them
+    void Recount();			// Recompute numClear from the map
 };
 
 #endif // BITMAP_H
@@ -0,0 +1,212 @@
+// disksched.cc
+//	Routines to keep the requests waiting for the disk, and disk
+//	scheduling policies, choosing which one the disk does next.
+//
+//	There are never many requests waiting, so each policy simply
+//	looks through all of them.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "system.h"
+#include "disksched.h"
+
+//----------------------------------------------------------------------
+// SeekDistance
+// 	Return how many tracks the head has to move to get from
+//	"headSector" to the sector of "request".
+//----------------------------------------------------------------------
+
+static int
+SeekDistance(DiskRequest *request, int headSector)
+{
+    int tracks = request->sector / SectorsPerTrack
+				- headSector / SectorsPerTrack;
+
+    return (tracks < 0) ? -tracks : tracks;
+}
+
+//----------------------------------------------------------------------
+// NewDiskScheduler
+// 	Create the scheduler for "policy", for the requests to "disk".
+//----------------------------------------------------------------------
+
+DiskScheduler *
+NewDiskScheduler(DiskPolicy policy, Disk *disk)
+{
+    switch (policy) {
+      case FCFSPolicy:
+	return new FCFSScheduler(disk);
+      case SSTFPolicy:
+	return new SSTFScheduler(disk);
+      case ScanPolicy:
+	return new ScanScheduler(disk);
+      case CLookPolicy:
+	return new CLookScheduler(disk);
+      case RotationalPolicy:
+	return new RotationalScheduler(disk);
+    }
+    ASSERT(FALSE);
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// DiskScheduler::DiskScheduler
+// 	Start with no requests waiting.
+//----------------------------------------------------------------------
+
+DiskScheduler::DiskScheduler(Disk *d)
+{
+    disk = d;
+    first = last = NULL;
+}
+
+//----------------------------------------------------------------------
+// DiskScheduler::Add
+// 	Put "request" at the end of the waiting requests.
+//----------------------------------------------------------------------
+
+void
+DiskScheduler::Add(DiskRequest *request)
+{
+    request->next = NULL;
+    if (last == NULL)
+	first = request;
+    else
+	last->next = request;
+    last = request;
+}
+
+//----------------------------------------------------------------------
+// DiskScheduler::Next
+// 	Take the request the policy chooses off the waiting requests, and
+//	return it; return NULL if there are none.
+//
+//	"headSector" -- the sector the disk did last
+//----------------------------------------------------------------------
+
+DiskRequest *
+DiskScheduler::Next(int headSector)
+{
+    DiskRequest **link, *request;
+
+    if (first == NULL)
+	return NULL;
+    link = Choose(headSector);
+    request = *link;
+    *link = request->next;
+    if (request == last)		// find the new end
+	for (last = first; last != NULL && last->next != NULL;
+							last = last->next)
+	    ;
+    return request;
+}
+
+//----------------------------------------------------------------------
+// FCFSScheduler::Choose
+// 	Take the requests in the order they were made.
+//----------------------------------------------------------------------
+
+DiskRequest **
+FCFSScheduler::Choose(int headSector)
+{
+    return &first;
+}
+
+//----------------------------------------------------------------------
+// SSTFScheduler::Choose
+// 	Shortest seek time first: take the request on the track nearest
+//	the head, the oldest of them if there is a tie.  Requests far
+//	from a busy part of the disk may wait a long time.
+//----------------------------------------------------------------------
+
+DiskRequest **
+SSTFScheduler::Choose(int headSector)
+{
+    DiskRequest **link, **best = &first;
+
+    for (link = &first->next; *link != NULL; link = &(*link)->next)
+	if (SeekDistance(*link, headSector) < SeekDistance(*best, headSector))
+	    best = link;
+    return best;
+}
+
+//----------------------------------------------------------------------
+// ScanScheduler::Choose
+// 	The elevator algorithm: keep moving the head the same way,
+//	taking the nearest request ahead of it, until there are none
+//	ahead; then turn around.  Requests are ordered by sector, so those
+//	on one track are taken in one pass.
+//----------------------------------------------------------------------
+
+DiskRequest **
+ScanScheduler::Choose(int headSector)
+{
+    DiskRequest **link, **best = NULL;
+    int sector;
+
+    for (;;) {
+	for (link = &first; *link != NULL; link = &(*link)->next) {
+	    sector = (*link)->sector;
+	    if (up ? (sector < headSector) : (sector > headSector))
+		continue;			// behind us
+	    if (best == NULL || (up ? (sector < (*best)->sector)
+				    : (sector > (*best)->sector)))
+		best = link;
+	}
+	if (best != NULL)
+	    return best;
+	up = !up;			// everything is behind us
+    }
+}
+
+//----------------------------------------------------------------------
+// CLookScheduler::Choose
+// 	Circular LOOK: like the elevator, but only sweeping to higher
+//	sectors.  When there are no requests ahead of the head, go back
+//	to the lowest one.  Each sector waits at most one sweep, however
+//	the requests are spread over the disk.
+//----------------------------------------------------------------------
+
+DiskRequest **
+CLookScheduler::Choose(int headSector)
+{
+    DiskRequest **link, **best = NULL, **lowest = &first;
+    int sector;
+
+    for (link = &first; *link != NULL; link = &(*link)->next) {
+	sector = (*link)->sector;
+	if (sector >= headSector
+			&& (best == NULL || sector < (*best)->sector))
+	    best = link;
+	if (sector < (*lowest)->sector)
+	    lowest = link;
+    }
+    return (best != NULL) ? best : lowest;
+}
+
+//----------------------------------------------------------------------
+// RotationalScheduler::Choose
+// 	Shortest positioning time first: ask the disk how long each
+//	request would take, counting the seek, waiting for the sector to
+//	come round, and the track buffer, and take the quickest.  Like
+//	SSTF, it can starve requests.
+//----------------------------------------------------------------------
+
+DiskRequest **
+RotationalScheduler::Choose(int headSector)
+{
+    DiskRequest **link, **best = &first;
+    int time, bestTime = disk->ComputeLatency(first->sector, first->writing);
+
+    for (link = &first->next; *link != NULL; link = &(*link)->next) {
+	time = disk->ComputeLatency((*link)->sector, (*link)->writing);
+	if (time < bestTime) {
+	    best = link;
+	    bestTime = time;
+	}
+    }
+    return best;
+}
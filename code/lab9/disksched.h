@@ -0,0 +1,116 @@
+// disksched.h
+//	Data structures for disk requests, and for the disk schedulers
+//	that choose which waiting request the disk does next.
+//
+//	The disk does one request at a time, and how long one takes
+//	depends on how far the head has to move to reach its track, and
+//	then how far the disk has to turn (see Disk::ComputeLatency).  So
+//	the order waiting requests are done in matters.
+//
+//	Schedulers are subclasses of DiskScheduler; which one is used is
+//	chosen when Nachos starts up (see the -ds flag in main.cc).
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef DISKSCHED_H
+#define DISKSCHED_H
+
+#include "copyright.h"
+#include "disk.h"
+
+// The following class describes one request to read or write a run of
+// consecutive sectors.  The caller fills it in and passes it to
+// SynchDisk::Submit, and must leave it alone until "callWhenDone" is
+// called.
+
+class DiskRequest {
+  public:
+    int sector;			// the first sector to read or write
+    int numSectors;		// how many, at most MaxRunSectors
+    char *data[MaxRunSectors];	// where each one's contents go or
+				// come from
+    bool writing;		// TRUE to write the sector
+    VoidFunctionPtr callWhenDone;	// called, with "callArg" and
+				// interrupts disabled, once the disk
+				// has done the request
+    _int callArg;
+    int queuedAt;		// when it was submitted
+    DiskRequest *next;		// next request waiting for the disk
+};
+
+// The available scheduling policies.
+
+enum DiskPolicy { FCFSPolicy,		// in the order they were made
+		  SSTFPolicy,		// the nearest track first
+		  ScanPolicy,		// the elevator: sweep the tracks
+					// up, then down, and so on
+		  CLookPolicy,		// sweep up only, then jump back to
+					// the lowest waiting request
+		  RotationalPolicy	// the one the disk can reach
+					// soonest, counting rotation
+};
+
+// The following class keeps the requests waiting for the disk, and
+// defines the interface of a scheduler.  Requests are kept in the order
+// they were made; a scheduler looks through them for the next one.
+
+class DiskScheduler {
+  public:
+    DiskScheduler(Disk *disk);
+    virtual ~DiskScheduler() {}
+
+    void Add(DiskRequest *request);	// Add a request to the waiting ones
+    DiskRequest *Next(int headSector);	// Remove and return the request to
+					// do next, with the head at
+					// "headSector"; NULL if none waits
+    bool IsEmpty() { return first == NULL; }
+
+  protected:
+    virtual DiskRequest **Choose(int headSector) = 0;
+					// Return the link to the request
+					// to do next; there is one
+    Disk *disk;			// the disk, to ask how long requests
+				// would take
+    DiskRequest *first;		// the waiting requests, oldest first
+    DiskRequest *last;
+};
+
+class FCFSScheduler : public DiskScheduler {
+  public:
+    FCFSScheduler(Disk *d) : DiskScheduler(d) {}
+    DiskRequest **Choose(int headSector);
+};
+
+class SSTFScheduler : public DiskScheduler {
+  public:
+    SSTFScheduler(Disk *d) : DiskScheduler(d) {}
+    DiskRequest **Choose(int headSector);
+};
+
+class ScanScheduler : public DiskScheduler {
+  public:
+    ScanScheduler(Disk *d) : DiskScheduler(d) { up = TRUE; }
+    DiskRequest **Choose(int headSector);
+
+  private:
+    bool up;			// is the head sweeping to higher tracks?
+};
+
+class CLookScheduler : public DiskScheduler {
+  public:
+    CLookScheduler(Disk *d) : DiskScheduler(d) {}
+    DiskRequest **Choose(int headSector);
+};
+
+class RotationalScheduler : public DiskScheduler {
+  public:
+    RotationalScheduler(Disk *d) : DiskScheduler(d) {}
+    DiskRequest **Choose(int headSector);
+};
+
+extern DiskScheduler *NewDiskScheduler(DiskPolicy policy, Disk *disk);
+					// Create a scheduler for a policy
+
+#endif // DISKSCHED_H
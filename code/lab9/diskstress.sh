@@ -0,0 +1,31 @@
+#!/bin/sh
+# diskstress.sh
+#	Run the disk cache stress test, test/diskstress.c, with caches
+#	from one sector up to the default size.  At every size each of
+#	its readers should say "ok"; the count of those is printed.
+#
+#	Run from anywhere, after building nachos here and the test
+#	programs.  Nachos runs in a scratch directory, on a disk of its
+#	own, so the DISK here is left alone; the programs are
+#	copied to it under short names, as names there are at most 9
+#	characters.  Exits 1 if any reader fails.
+
+readers=4			# NumReaders in diskstress.c
+lab9=`cd \`dirname $0\` && pwd`
+test=$lab9/../test
+scratch=`mktemp -d /tmp/diskstress.XXXXXX` || exit 1
+trap 'rm -rf $scratch' 0
+
+cd $scratch
+status=0
+for sectors in 1 2 4 8 16 64; do
+    $lab9/nachos -f > /dev/null
+    $lab9/nachos -cp $test/diskstress.noff stress > /dev/null
+    $lab9/nachos -cp $test/sort.noff sort > /dev/null
+    $lab9/nachos -cp $test/matmult.noff matmult > /dev/null
+    ok=`$lab9/nachos -dc $sectors -x stress \
+				| grep -a -c "diskstress: reader . ok"`
+    echo "-dc $sectors: $ok of $readers readers ok"
+    [ "$ok" -eq $readers ] || status=1
+done
+exit $status
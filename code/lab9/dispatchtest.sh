@@ -0,0 +1,32 @@
+#!/bin/sh
+# dispatchtest.sh
+#	Compare the switch and the computed-goto instruction dispatch of
+#	the MIPS simulator, on matmult and sort.  The "Host:" line printed
+#	at halt gives user instructions per host second.
+#
+#	Run from anywhere, after building the test programs.  Nachos runs
+#	in a scratch directory, on a disk of its own, so the DISK here is
+#	left alone.
+
+lab9=`cd \`dirname $0\` && pwd`
+test=$lab9/../test
+scratch=`mktemp -d /tmp/dispatchtest.XXXXXX` || exit 1
+trap 'rm -rf $scratch' 0
+
+cd $lab9
+for dispatch in switch goto; do
+    make clean > /dev/null
+    make DISPATCH=$dispatch > /dev/null || exit 1
+    cp arch/*/bin/nachos $scratch/nachos-$dispatch
+done
+
+cd $scratch
+./nachos-switch -f > /dev/null
+./nachos-switch -cp $test/matmult.noff matmult.noff > /dev/null
+./nachos-switch -cp $test/sort.noff sort.noff > /dev/null
+for dispatch in switch goto; do
+    for program in matmult sort; do
+	echo "$dispatch $program:"
+	./nachos-$dispatch -x $program.noff | grep Host
+    done
+done
@@ -25,6 +25,9 @@
 #include "system.h"
 #include "syscall.h"
 
+#define IOChunkSize	DefaultPageSize	// bytes Read and Write move through
+					// the kernel at a time
+
 //----------------------------------------------------------------------
 // ExceptionHandler
 // 	Entry point into the Nachos kernel.  Called when a user program
@@ -73,6 +76,23 @@ StartThread(int functionPC) {
                     // the address space exits by doing the syscall "exit"
 }
 
+//----------------------------------------------------------------------
+// PrintContent
+// 	Print "numBytes" bytes read from a file, as text; the bytes 0 to
+//	9 are printed as the digits.  "buffer" has room for a null after
+//	them.
+//----------------------------------------------------------------------
+
+static void
+PrintContent(char *buffer, int numBytes)
+{
+    for (int i = 0; i < numBytes; i++)
+	if (buffer[i] >= 0 && buffer[i] <= 9)
+	    buffer[i] += '0';
+    buffer[numBytes] = '\0';
+    printf("%s", buffer);
+}
+
 char toupper(char c) {
     if(c>='a' && c<='z') {
         c+='A'-'a';
@@ -226,6 +246,7 @@ ExceptionHandler(ExceptionType which)
         switch(type) {
             case SC_Halt: {
                 DEBUG('a', "Shutdown, initiated by user program.\n");
+                synchDisk->Flush();     // the disk cache holds writes
                 interrupt->Halt();
                 break;
             }
@@ -243,11 +264,12 @@ ExceptionHandler(ExceptionType which)
                 //read argument (i.e. filename) of Exec(filename)
                 char filename[128]; 
                 int addr=machine->ReadRegister(4); 
-                int ii=0;
                 //read filename from mainMemory
-                do{
-                    machine->ReadMem(addr+ii,1,(int *)&filename[ii]);
-                } while (filename[ii++]!='\0');
+                if (machine->CopyStringFromUser(addr, filename, 128) < 0) {
+                    machine->WriteRegister(2,-1); 
+                    AdvancePC(); 
+                    break;
+                }
                 
                 //---------------------------------------------------------
                 //
@@ -633,8 +655,7 @@ ExceptionHandler(ExceptionType which)
                 }
                 
                 //new address space
-                AddrSpace *space = new AddrSpace(executable); 
-                delete executable; // close file
+                AddrSpace *space = new AddrSpace(executable); // keeps the file open
                 
                 DEBUG('H',"Execute system call Exec(\"%s\"), it's SpaceId(pid) = %d \n",filename,space->GetSpaceId());
                 //new and fork thread
@@ -684,11 +705,8 @@ ExceptionHandler(ExceptionType which)
             case SC_Create:{
                 int addr = machine->ReadRegister(4);
                 char filename[128];
-                for(int i = 0; i < 128; i++){
-                    machine->ReadMem(addr+i,1,(int *)&filename[i]);
-                    if(filename[i] == '\0') break;
-                }
-                if(!fileSystem->Create(filename,0)) printf("create file %s failed!\n",filename);
+                if(machine->CopyStringFromUser(addr, filename, 128) < 0
+                   || !fileSystem->Create(filename,0)) printf("create file %s failed!\n",filename);
                 else printf("create file %s succeed!\n",filename);
                 AdvancePC();
                 break;
@@ -697,11 +715,9 @@ ExceptionHandler(ExceptionType which)
             case SC_Open:{
                 int addr = machine->ReadRegister(4), fileId;
                 char filename[128];
-                for(int i = 0; i < 128; i++){
-                    machine->ReadMem(addr+i,1,(int *)&filename[i]);
-                    if(filename[i] == '\0') break;
-                }
-                OpenFile *openfile = fileSystem->Open(filename);
+                OpenFile *openfile = NULL;
+                if(machine->CopyStringFromUser(addr, filename, 128) >= 0)
+                    openfile = fileSystem->Open(filename);
                 if(openfile == NULL) {
                     printf("File \"%s\" not Exists, could not open it.\n",filename);
                     fileId = -1;
@@ -721,30 +737,33 @@ ExceptionHandler(ExceptionType which)
                 int addr = machine->ReadRegister(4);
                 int size = machine->ReadRegister(5);       // 字节数
                 int fileId = machine->ReadRegister(6);      // fd
-        
-                // 打开文件
                 OpenFile *openfile = currentThread->space->getFileId(fileId);
 
-                // 打开文件读取信息
-                char buffer[size+1];
-                int readnum = 0;
-                if(fileId == 0) readnum = openfile->ReadStdin(buffer,size);
-                else readnum = openfile->Read(buffer,size);
-
-                // printf("readnum:%d,fileId:%d,size:%d\n",readnum,fileId,size);
-                // printf("buffer = %s\n", buffer);
-                for(int i = 0; i < readnum; i++)
-                    machine->WriteMem(addr,1,buffer[i]);
-                buffer[readnum] = '\0';
-
-                for(int i = 0; i < readnum; i++)
-                    if(buffer[i] >= 0 && buffer[i] <= 9) buffer[i] = buffer[i]+0x30;
-                char *buf = buffer;
-                if(readnum > 0){
-                    if(fileId != 0)
-                        printf("Read file (%d) succeed! the content is \"%s\", the length is %d\n",fileId,buf,readnum);
+                // 一次读取 IOChunkSize 字节, 复制到用户空间
+                char buffer[IOChunkSize + 1];
+                int readnum = 0, chunk, n;
+                bool failed = (openfile == NULL || size < 0);
+                while (!failed && readnum < size) {
+                    chunk = min(size - readnum, IOChunkSize);
+                    if(fileId == 0) n = openfile->ReadStdin(buffer,chunk);
+                    else n = openfile->Read(buffer,chunk);
+                    if (n <= 0) break;
+                    if (!machine->CopyToUser(addr + readnum, buffer, n)) {
+                        failed = TRUE;
+                        break;
+                    }
+                    if(fileId != 0) {
+                        if (readnum == 0)
+                            printf("Read file (%d) succeed! the content is \"",fileId);
+                        PrintContent(buffer, n);
+                    }
+                    readnum += n;
+                    if (fileId == 0 || n < chunk) break;    // no more for now
                 }
-                else printf("\nRead file failed!\n");
+                if(readnum > 0 && fileId != 0)
+                    printf("\", the length is %d\n",readnum);
+                if(failed) readnum = -1;
+                if(readnum <= 0) printf("\nRead file failed!\n");
                 machine->WriteRegister(2,readnum);
                 AdvancePC();
                 break;
@@ -755,43 +774,38 @@ ExceptionHandler(ExceptionType which)
                 int addr = machine->ReadRegister(4);       // 写入数据
                 int size = machine->ReadRegister(5);       // 字节数
                 int fileId = machine->ReadRegister(6);      // fd
-                
-                // 创建文件
-                OpenFile *openfile = new OpenFile(fileId);
-                ASSERT(openfile != NULL);
-
-                // 读取具体写入的数据
-                char buffer[128];
-                for(int i = 0; i < size; i++){
-                    machine->ReadMem(addr+i,1,(int *)&buffer[i]);
-                    if(buffer[i] == '\0') break;
-                }
-                buffer[size] = '\0';
-
+                bool console = (fileId == 1 || fileId == 2);
 
                 // 打开文件
-                openfile = currentThread->space->getFileId(fileId);
+                OpenFile *openfile = currentThread->space->getFileId(fileId);
                 if(openfile == NULL) {
                     printf("Failed to Open file \"%d\".\n",fileId);
                     AdvancePC();
                     break;
                 }
-                if(fileId == 1 || fileId == 2){
-                    openfile->WriteStdout(buffer,size);
-                    // delete []buffer;
-                    AdvancePC();
-                    break;
-                }
 
-                // 写入数据
-                int writePos = openfile->Length();
-                openfile->Seek(writePos);
-
-                // 在 writePos 后面进行数据添加
-                int writtenBytes = openfile->Write(buffer,size);
-                if(writtenBytes == 0) printf("Write file failed!\n");
-                else if(fileId != 1 & fileId != 2)
-                    printf("\"%s\" has wrote in file %d succeed!\n",buffer,fileId);
+                // 在文件末尾进行数据添加, 一次复制 IOChunkSize 字节
+                if(!console) openfile->Seek(openfile->Length());
+                char buffer[IOChunkSize + 1];
+                int writtenBytes = 0, chunk, n;
+                while (writtenBytes < size) {
+                    chunk = min(size - writtenBytes, IOChunkSize);
+                    if (!machine->CopyFromUser(addr + writtenBytes, buffer, chunk))
+                        break;
+                    buffer[chunk] = '\0';
+                    if(console) n = openfile->WriteStdout(buffer,chunk);
+                    else {
+                        n = openfile->Write(buffer,chunk);
+                        if (n <= 0) break;
+                        if (writtenBytes == 0) printf("\"");
+                        printf("%s", buffer);
+                    }
+                    writtenBytes += n;
+                }
+                if(writtenBytes > 0 && !console)
+                    printf("\" has wrote in file %d succeed!\n",fileId);
+                if(size < 0 || writtenBytes < size)
+                    printf("Write file failed!\n");
                 AdvancePC();
                 break;
             }
@@ -814,7 +828,7 @@ ExceptionHandler(ExceptionType which)
                 printf("Syscall exception type: SC_Fork, CurrentThreadId: %d\n",currentThread->GetSpaceId());
                 int functionPC = machine->ReadRegister(4);
 
-                AddrSpace *space = currentThread->space;
+                AddrSpace *space = new AddrSpace(currentThread->space);
                 // space->Print();
 
                 Thread *thread = new Thread("forked thread");
@@ -835,11 +849,36 @@ ExceptionHandler(ExceptionType which)
                 currentThread->Yield();
                 break;
             }
+            case SC_Sbrk:{
+                int increment = machine->ReadRegister(4);
+
+                machine->WriteRegister(2, currentThread->space->Sbrk(increment));
+                AdvancePC();
+                break;
+            }
             default: {
                 printf("Unexpected syscall %d %d\n", which, type);
                 ASSERT(FALSE);
             }
         }
+    } else if (which == PageFaultException) {
+        int badVAddr = machine->ReadRegister(BadVAddrReg);
+
+        if (!currentThread->space->HandlePageFault(badVAddr)) {
+            printf("Bad address 0x%x, process %d terminated\n", badVAddr,
+                                    currentThread->GetSpaceId());
+            currentThread->SetExitCode(-1);
+            currentThread->Finish();
+        }
+    } else if (which == ReadOnlyException) {
+        int badVAddr = machine->ReadRegister(BadVAddrReg);
+
+        if (!currentThread->space->HandleWriteFault(badVAddr)) {
+            printf("Write to read-only address 0x%x, process %d terminated\n",
+                                    badVAddr, currentThread->GetSpaceId());
+            currentThread->SetExitCode(-1);
+            currentThread->Finish();
+        }
     } else {
 	    printf("Unexpected user mode exception %d %d\n", which, type);
         // currentThread->space->Print();
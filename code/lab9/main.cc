@@ -9,8 +9,10 @@
 // 	Most of this file is not needed until later assignments.
 //
 // Usage: nachos -d <debugflags> -rs <random seed #>
-//		-s -x <nachos file> -c <consoleIn> <consoleOut>
-//		-f -cp <unix file> <nachos file>
+//		-s -bb -prof -x <nachos file> -c <consoleIn> <consoleOut>
+//		-rp <clock|sc|nru|ws> -mem <frames> -pagesize <bytes>
+//		-f -dc <sectors> -ds <fcfs|sstf|scan|clook|rot>
+//		-cp <unix file> <nachos file>
 //		-p <nachos file> -r <nachos file> -l -D -t
 //              -n <network reliability> -m <machine id>
 //              -o <other machine id>
@@ -22,11 +24,25 @@
 //
 //  USER_PROGRAM
 //    -s causes user programs to be executed in single-step mode
+//    -bb runs user programs a basic block at a time, checking for
+//	interrupts only between blocks
+//    -prof counts the instructions user programs execute, and prints
+//	the hottest PCs and the opcode mix when Nachos halts
+//    -rp chooses the page replacement policy: clock (the default),
+//	sc (second chance), nru (enhanced NRU) or ws (working set)
+//    -mem sets the number of frames of physical memory (default 64)
+//    -pagesize sets the page size in bytes, a power of two from the disk
+//	sector size (the default) to the largest file size
 //    -x runs a user program
 //    -c tests the console
 //
 //  FILESYS
 //    -f causes the physical disk to be formatted
+//    -dc sets the number of sectors in the disk cache (default 64; at
+//	most the number of sectors on the disk)
+//    -ds chooses the disk scheduling policy: fcfs (the default), sstf
+//	(shortest seek first), scan (elevator), clook (circular LOOK) or
+//	rot (shortest seek plus rotation first)
 //    -cp copies a file from UNIX to Nachos
 //    -p prints a Nachos file to stdout
 //    -r removes a Nachos file from the file system
@@ -30,6 +30,7 @@ OpenFile::OpenFile(int sector)
     hdr->FetchFrom(sector);
     seekPosition = 0;
     hdrSector=sector;
+    nextSequential = 0;
 }
 
 //----------------------------------------------------------------------
@@ -96,13 +97,30 @@ OpenFile::Write(char *into, int numBytes)
 //	sector at a time.  Thus:
 //
 //	For ReadAt:
-//	   We read in all of the full or partial sectors that are part of the
-//	   request, but we only copy the part we are interested in.
+//	   We read the full sectors that are part of the request straight
+//	   into the caller's buffer, each run of them that is consecutive
+//	   on disk with one ReadSectors, so that what isn't cached comes
+//	   in with one disk request per run.  For a partial sector, at
+//	   either end, we pin the disk cache's copy, and only copy the
+//	   part we are interested in.
 //	For WriteAt:
-//	   We must first read in any sectors that will be partially written,
-//	   so that we don't overwrite the unmodified portion.  We then copy
-//	   in the data that will be modified, and write back all the full
-//	   or partial sectors that are part of the request.
+//	   We write each full sector straight from the caller's buffer.  A
+//	   sector that will be partially written is pinned in the disk
+//	   cache (read in, if it isn't there), so that we don't overwrite
+//	   the unmodified portion; we then copy in the data that will be
+//	   modified, and mark it dirty.  Writes only go as far as the
+//	   cache, which writes consecutive dirty sectors back together.
+//
+//	So a page-sized transfer at a page-aligned position, such as the
+//	pager's, goes directly between the disk and the page's frame.
+//
+//	A read that starts where the last one ended is taken to mean the
+//	file is being read front to back, so the next ReadAheadSectors
+//	sectors are read into the disk cache in the background, while
+//	the caller goes on with the data it has, again a run at a time.
+//	Fewer are read ahead, or none, if the cache can't spare the
+//	buffers (see SynchDisk::SpareBuffers), so that reading ahead
+//	several files at once doesn't tie up the whole cache.
 //
 //	"into" -- the buffer to contain the data to be read from disk 
 //	"from" -- the buffer containing the data to be written to disk 
@@ -115,8 +133,7 @@ int
 OpenFile::ReadAt(char *into, int numBytes, int position)
 {
     int fileLength = hdr->FileLength();
-    int i, firstSector, lastSector, numSectors;
-    char *buf;
+    int done, offset, chunk, sector, count;
 
     if ((numBytes <= 0) || (position >= fileLength))
     	return 0; 				// check request
@@ -125,19 +142,32 @@ OpenFile::ReadAt(char *into, int numBytes, int position)
     DEBUG('f', "Reading %d bytes at %d, from file of length %d.\n", 	
 			numBytes, position, fileLength);
 
-    firstSector = divRoundDown(position, SectorSize);
-    lastSector = divRoundDown(position + numBytes - 1, SectorSize);
-    numSectors = 1 + lastSector - firstSector;
-
-    // read in all the full and partial sectors that we need
-    buf = new char[numSectors * SectorSize];
-    for (i = firstSector; i <= lastSector; i++)	
-        synchDisk->ReadSector(hdr->ByteToSector(i * SectorSize), 
-					&buf[(i - firstSector) * SectorSize]);
-
-    // copy the part we want
-    bcopy(&buf[position - (firstSector * SectorSize)], into, numBytes);
-    delete [] buf;
+    for (done = 0; done < numBytes; done += chunk) {
+	offset = (position + done) % SectorSize;
+	chunk = min(SectorSize - offset, numBytes - done);
+	sector = hdr->ByteToSector(position + done);
+	if (chunk == SectorSize) {		// a run of full sectors
+	    count = RunLength(position + done, (numBytes - done) / SectorSize);
+	    synchDisk->ReadSectors(sector, count, into + done);
+	    chunk = count * SectorSize;
+	} else {				// copy the part we want
+	    bcopy(synchDisk->PinSector(sector, FALSE) + offset, into + done,
+								chunk);
+	    synchDisk->UnpinSector(sector, FALSE);
+	}
+    }
+    if (position == nextSequential) {
+	int next = divRoundUp(position + numBytes, SectorSize) * SectorSize;
+	int ahead = min(ReadAheadSectors, synchDisk->SpareBuffers());
+
+	for (int i = 0; i < ahead && next < fileLength; i += count) {
+	    count = RunLength(next, min(ahead - i,
+				divRoundUp(fileLength - next, SectorSize)));
+	    synchDisk->ReadAhead(hdr->ByteToSector(next), count);
+	    next += count * SectorSize;
+	}
+    }
+    nextSequential = position + numBytes;
     return numBytes;
 }
 
@@ -145,9 +175,7 @@ int
 OpenFile::WriteAt(char *from, int numBytes, int position)
 {
     int fileLength = hdr->FileLength();
-    int i, firstSector, lastSector, numSectors;
-    bool firstAligned, lastAligned;
-    char *buf;
+    int done, offset, chunk, sector;
 
     if ((numBytes <= 0) || (position > fileLength))    // parameter fault
 	    return -1;				// check request
@@ -165,31 +193,38 @@ OpenFile::WriteAt(char *from, int numBytes, int position)
     DEBUG('f', "Writing %d bytes at %d, from file of length %d.\n", 	
 			numBytes, position, fileLength);
 
-    firstSector = divRoundDown(position, SectorSize);
-    lastSector = divRoundDown(position + numBytes - 1, SectorSize);
-    numSectors = 1 + lastSector - firstSector;
-
-    buf = new char[numSectors * SectorSize];        // buffer contains the sector data
-
-    firstAligned = (bool)(position == (firstSector * SectorSize));
-    lastAligned = (bool)((position + numBytes) == ((lastSector + 1) * SectorSize));
+    for (done = 0; done < numBytes; done += chunk) {
+	offset = (position + done) % SectorSize;
+	chunk = min(SectorSize - offset, numBytes - done);
+	sector = hdr->ByteToSector(position + done);
+	if (chunk == SectorSize)		// a full sector
+	    synchDisk->WriteSector(sector, from + done);
+	else {			// change the bytes we want, in place
+	    bcopy(from + done, synchDisk->PinSector(sector, FALSE) + offset,
+								chunk);
+	    synchDisk->UnpinSector(sector, TRUE);
+	}
+    }
+    return numBytes;
+}
 
-// read in first and last sector, if they are to be partially modified
-    if (!firstAligned)
-        ReadAt(buf, SectorSize, firstSector * SectorSize);	
-    if (!lastAligned && ((firstSector != lastSector) || firstAligned))
-        ReadAt(&buf[(lastSector - firstSector) * SectorSize], 
-				SectorSize, lastSector * SectorSize);	
+//----------------------------------------------------------------------
+// OpenFile::RunLength
+// 	Return how many of the "maxSectors" sectors of the file starting
+//	with the one at "position" follow each other on disk, so that
+//	they can be transferred with one disk request.
+//----------------------------------------------------------------------
 
-// copy in the bytes we want to change 
-    bcopy(from, &buf[position - (firstSector * SectorSize)], numBytes);
+int
+OpenFile::RunLength(int position, int maxSectors)
+{
+    int first = hdr->ByteToSector(position);
+    int count;
 
-// write modified sectors back    
-    for (i = firstSector; i <= lastSector; i++)	
-        synchDisk->WriteSector(hdr->ByteToSector(i * SectorSize), 
-					&buf[(i - firstSector) * SectorSize]);
-    delete [] buf;
-    return numBytes;
+    for (count = 1; count < maxSectors; count++)
+	if (hdr->ByteToSector(position + count * SectorSize) != first + count)
+	    break;
+    return count;
 }
 
 //----------------------------------------------------------------------
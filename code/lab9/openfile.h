@@ -61,6 +61,9 @@ class OpenFile {
 #else // FILESYS
 class FileHeader;
 
+#define ReadAheadSectors	4	// sectors read ahead of a file
+					// being read sequentially
+
 class OpenFile {
   public:
     OpenFile(int sector);		// Open a file whose header is located
@@ -87,6 +90,8 @@ class OpenFile {
 					// end of file, tell, lseek back 
 	
 	void WriteBack();
+    int HeaderSector() { return hdrSector; }	// Where the file header
+						// is on disk
 
 #ifdef FILESYS
     OpenFile(char *type) {}
@@ -98,6 +103,11 @@ class OpenFile {
     FileHeader *hdr;			// Header for this file 
     int seekPosition;			// Current position within the file
     int hdrSector;
+    int nextSequential;			// Where the last ReadAt ended; a
+					// read from here is sequential
+    int RunLength(int position, int maxSectors);
+					// How many sectors from "position"
+					// are consecutive on disk
 };
 
 #endif // FILESYS
@@ -30,10 +30,9 @@ StartProcess(char *filename)
 	printf("Unable to open file %s\n", filename);
 	return;
     }
-    space = new AddrSpace(executable);    
-    currentThread->space = space;
+    space = new AddrSpace(executable);	// keeps the file open, to
+    currentThread->space = space;	// page in from
     space->Print();
-    delete executable;			// close file
 
     space->InitRegisters();		// set the initial register values
     space->RestoreState();		// load page table register
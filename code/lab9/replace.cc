@@ -0,0 +1,390 @@
+// replace.cc
+//	Routines to keep track of the pages in each frame of physical
+//	memory, and page replacement policies, choosing a frame to evict
+//	when there are no free ones.
+//
+//	All of them approximate LRU from the use bits set by the
+//	hardware; the hardware never clears a use bit, so the policies
+//	clear them as they sweep, to see which pages are used again.
+//	None of them needs the frames to be scanned from the start each
+//	time, so a choice costs O(1) frames examined, amortized.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "system.h"
+#include "replace.h"
+
+//----------------------------------------------------------------------
+// FrameInfo::AddMapping
+// 	Record that page "vpn" of "space", translated by "entry", is in
+//	this frame.
+//----------------------------------------------------------------------
+
+void
+FrameInfo::AddMapping(AddrSpace *space, int vpn, TranslationEntry *entry)
+{
+    FrameMapping *m = new FrameMapping;
+
+    m->space = space;
+    m->virtualPage = vpn;
+    m->entry = entry;
+    m->next = mappings;
+    mappings = m;
+    numMappings++;
+}
+
+//----------------------------------------------------------------------
+// FrameInfo::RemoveMapping
+// 	Record that page "vpn" of "space" is no longer in this frame.
+//	The frame is free once no page is in it.
+//----------------------------------------------------------------------
+
+void
+FrameInfo::RemoveMapping(AddrSpace *space, int vpn)
+{
+    FrameMapping **prev, *m;
+
+    for (prev = &mappings; (m = *prev) != NULL; prev = &m->next)
+	if (m->space == space && m->virtualPage == vpn) {
+	    *prev = m->next;
+	    numMappings--;
+	    delete m;
+	    return;
+	}
+    ASSERT(FALSE);			// the page wasn't here
+}
+
+//----------------------------------------------------------------------
+// FrameInfo::Used
+// FrameInfo::Dirty
+// 	Return TRUE if any page in the frame has been used, or modified,
+//	since its bit was last cleared.
+//----------------------------------------------------------------------
+
+bool
+FrameInfo::Used()
+{
+    for (FrameMapping *m = mappings; m != NULL; m = m->next)
+	if (m->entry->use)
+	    return TRUE;
+    return FALSE;
+}
+
+bool
+FrameInfo::Dirty()
+{
+    for (FrameMapping *m = mappings; m != NULL; m = m->next)
+	if (m->entry->dirty)
+	    return TRUE;
+    return FALSE;
+}
+
+//----------------------------------------------------------------------
+// FrameInfo::ClearUse
+// 	Clear the use bit of every page in the frame.
+//----------------------------------------------------------------------
+
+void
+FrameInfo::ClearUse()
+{
+    for (FrameMapping *m = mappings; m != NULL; m = m->next)
+	m->entry->use = FALSE;
+}
+
+//----------------------------------------------------------------------
+// FrameAllocator::FrameAllocator
+// 	Put every frame on the zeroed stack, since the machine starts
+//	with memory cleared, frame 0 on top, so that frames are first
+//	handed out in order.
+//----------------------------------------------------------------------
+
+FrameAllocator::FrameAllocator(int nFrames)
+{
+    numFrames = nFrames;
+    dirtyFrames = new int[numFrames];
+    zeroFrames = new int[numFrames];
+    zeroed = new bool[numFrames];
+    numDirty = 0;
+    for (numZero = 0; numZero < numFrames; numZero++) {
+	zeroFrames[numZero] = numFrames - 1 - numZero;
+	zeroed[numZero] = TRUE;
+    }
+}
+
+FrameAllocator::~FrameAllocator()
+{
+    delete [] dirtyFrames;
+    delete [] zeroFrames;
+    delete [] zeroed;
+}
+
+//----------------------------------------------------------------------
+// FrameAllocator::Allocate
+// 	Take a frame off one of the free stacks; return -1 if they are
+//	both empty.  Zeroed frames are kept for callers that want them,
+//	unless there are no others.  The caller can tell which kind it
+//	got from IsZeroed.
+//
+//	"wantZero" -- TRUE if the frame is to start out as zeroes
+//----------------------------------------------------------------------
+
+int
+FrameAllocator::Allocate(bool wantZero)
+{
+    if (numZero > 0 && (wantZero || numDirty == 0))
+	return zeroFrames[--numZero];
+    if (numDirty > 0)
+	return dirtyFrames[--numDirty];
+    return -1;
+}
+
+//----------------------------------------------------------------------
+// FrameAllocator::Free
+// 	Put a frame that is no longer in use back on the free stacks.
+//	We don't know what is in it, so it isn't zeroed.
+//----------------------------------------------------------------------
+
+void
+FrameAllocator::Free(int frame)
+{
+    ASSERT(frame >= 0 && frame < numFrames && NumFree() < numFrames);
+    zeroed[frame] = FALSE;
+    dirtyFrames[numDirty++] = frame;
+}
+
+//----------------------------------------------------------------------
+// FrameAllocator::ZeroFrame
+// 	Fill one free frame with zeroes, and move it to the zeroed stack.
+//	Return FALSE if there was no frame left to zero.
+//----------------------------------------------------------------------
+
+bool
+FrameAllocator::ZeroFrame()
+{
+    int frame;
+
+    if (numDirty == 0)
+	return FALSE;
+    frame = dirtyFrames[--numDirty];
+    bzero(&machine->mainMemory[frame * PageSize], PageSize);
+    zeroed[frame] = TRUE;
+    zeroFrames[numZero++] = frame;
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// NewPageReplacer
+// 	Create the replacer for "policy", managing the "numFrames"
+//	entries of the frame table "frames".
+//----------------------------------------------------------------------
+
+PageReplacer *
+NewPageReplacer(ReplacementPolicy policy, FrameInfo *frames, int numFrames)
+{
+    switch (policy) {
+      case ClockPolicy:
+	return new ClockReplacer(frames, numFrames);
+      case SecondChancePolicy:
+	return new SecondChanceReplacer(frames, numFrames);
+      case NRUPolicy:
+	return new NRUReplacer(frames, numFrames);
+      case WorkingSetPolicy:
+	return new WorkingSetReplacer(frames, numFrames);
+    }
+    ASSERT(FALSE);
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// PageReplacer::PageReplacer
+// 	Initialize the state common to all policies.
+//----------------------------------------------------------------------
+
+PageReplacer::PageReplacer(FrameInfo *f, int n)
+{
+    frames = f;
+    numFrames = n;
+    hand = 0;
+}
+
+//----------------------------------------------------------------------
+// ClockReplacer::ChooseVictim
+// 	Sweep the frames in order, clearing use bits, and stop at the
+//	first one whose page hasn't been used since the hand last passed.
+//----------------------------------------------------------------------
+
+int
+ClockReplacer::ChooseVictim()
+{
+    int frame;
+
+    for (;;) {
+	frame = hand;
+	hand = (hand + 1) % numFrames;
+	if (!frames[frame].Used())
+	    return frame;
+	frames[frame].ClearUse();
+    }
+}
+
+//----------------------------------------------------------------------
+// SecondChanceReplacer::SecondChanceReplacer
+// 	Start with an empty queue of loaded frames.
+//----------------------------------------------------------------------
+
+SecondChanceReplacer::SecondChanceReplacer(FrameInfo *f, int n)
+	: PageReplacer(f, n)
+{
+    queue = new int[n];
+    queued = new bool[n];
+    for (int i = 0; i < n; i++)
+	queued[i] = FALSE;
+    head = count = 0;
+}
+
+SecondChanceReplacer::~SecondChanceReplacer()
+{
+    delete [] queue;
+    delete [] queued;
+}
+
+//----------------------------------------------------------------------
+// SecondChanceReplacer::Loaded
+// 	Put a newly loaded frame at the back of the queue.
+//----------------------------------------------------------------------
+
+void
+SecondChanceReplacer::Loaded(int frame)
+{
+    if (queued[frame])			// freed and reloaded while queued
+	return;
+    queue[(head + count++) % numFrames] = frame;
+    queued[frame] = TRUE;
+}
+
+//----------------------------------------------------------------------
+// SecondChanceReplacer::ChooseVictim
+// 	Take the frame loaded longest ago, unless its page has been used
+//	since it was queued; then clear the use bit and move it to the
+//	back, giving it a second chance.
+//----------------------------------------------------------------------
+
+int
+SecondChanceReplacer::ChooseVictim()
+{
+    int frame;
+
+    for (;;) {
+	ASSERT(count > 0);
+	frame = queue[head];
+	head = (head + 1) % numFrames;
+	count--;
+	if (!frames[frame].Used()) {
+	    queued[frame] = FALSE;	// Loaded will queue it again
+	    return frame;
+	}
+	frames[frame].ClearUse();
+	queue[(head + count++) % numFrames] = frame;
+    }
+}
+
+//----------------------------------------------------------------------
+// NRUReplacer::ChooseVictim
+// 	The enhanced clock algorithm.  Pages fall into four classes by
+//	(use, dirty); take one from the lowest class, preferring unused
+//	pages, and among those clean ones, which need no disk write.
+//
+//	First sweep once looking for an unused, clean page without
+//	touching anything.  Then sweep again for an unused, dirty page,
+//	clearing use bits on the way.  If neither turns up, every page
+//	has now had its use bit cleared, so repeating finds a victim.
+//----------------------------------------------------------------------
+
+int
+NRUReplacer::ChooseVictim()
+{
+    int frame, i;
+
+    for (;;) {
+	for (i = 0; i < numFrames; i++) {
+	    frame = hand;
+	    hand = (hand + 1) % numFrames;
+	    if (!frames[frame].Used() && !frames[frame].Dirty())
+		return frame;
+	}
+	for (i = 0; i < numFrames; i++) {
+	    frame = hand;
+	    hand = (hand + 1) % numFrames;
+	    if (!frames[frame].Used())
+		return frame;
+	    frames[frame].ClearUse();
+	}
+    }
+}
+
+//----------------------------------------------------------------------
+// WorkingSetReplacer::WorkingSetReplacer
+// 	Start with no record of when any frame was used.
+//----------------------------------------------------------------------
+
+WorkingSetReplacer::WorkingSetReplacer(FrameInfo *f, int n)
+	: PageReplacer(f, n)
+{
+    lastUse = new int[n];
+    for (int i = 0; i < n; i++)
+	lastUse[i] = 0;
+}
+
+WorkingSetReplacer::~WorkingSetReplacer()
+{
+    delete [] lastUse;
+}
+
+//----------------------------------------------------------------------
+// WorkingSetReplacer::Loaded
+// 	A newly loaded page is in the working set.
+//----------------------------------------------------------------------
+
+void
+WorkingSetReplacer::Loaded(int frame)
+{
+    lastUse[frame] = stats->totalTicks;
+}
+
+//----------------------------------------------------------------------
+// WorkingSetReplacer::ChooseVictim
+// 	The WSClock algorithm.  Sweep the frames like the clock; a used
+//	page is in the working set, so note the time and clear its use
+//	bit.  An unused page that hasn't been used for WorkingSetWindow
+//	ticks has left the working set, and if it is clean, it is taken.
+//
+//	If a whole sweep finds no such page, take an old dirty page if
+//	there was one, or failing that, the page unused for longest.
+//----------------------------------------------------------------------
+
+int
+WorkingSetReplacer::ChooseVictim()
+{
+    int now = stats->totalTicks;
+    int frame, oldDirty = -1, oldest = hand;
+
+    for (int i = 0; i < numFrames; i++) {
+	frame = hand;
+	hand = (hand + 1) % numFrames;
+	if (frames[frame].Used()) {
+	    frames[frame].ClearUse();
+	    lastUse[frame] = now;
+	} else if (now - lastUse[frame] > WorkingSetWindow) {
+	    if (!frames[frame].Dirty())
+		return frame;
+	    if (oldDirty < 0)
+		oldDirty = frame;
+	}
+	if (lastUse[frame] < lastUse[oldest])
+	    oldest = frame;
+    }
+    return (oldDirty >= 0) ? oldDirty : oldest;
+}
@@ -0,0 +1,176 @@
+// replace.h
+//	Data structures for choosing which page to evict when physical
+//	memory is full.
+//
+//	The frame table is an inverted page table: one entry per frame of
+//	physical memory, saying which pages of which address spaces are
+//	in it.  A frame usually holds one page, but a cloned address space
+//	shares its parent's frames until one of them writes, and every
+//	address space running a program shares the frames holding its
+//	code.  The number of pages in a frame is its reference count.  A page
+//	replacement policy looks at the use and dirty bits Machine::Translate
+//	keeps in the page table entries of the frames, and picks a frame
+//	to take away.
+//
+//	Policies are subclasses of PageReplacer; which one is used is
+//	chosen when Nachos starts up (see the -rp flag in main.cc).
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef REPLACE_H
+#define REPLACE_H
+
+#include "copyright.h"
+#include "translate.h"
+
+class AddrSpace;
+class TextSegment;
+
+// The following class records one page that is in a frame.
+
+class FrameMapping {
+  public:
+    AddrSpace *space;		// address space the page belongs to
+    int virtualPage;		// which of its pages it is
+    TranslationEntry *entry;	// its page table entry
+    FrameMapping *next;		// next page sharing the frame
+};
+
+// The following class records what is in one frame of physical memory.
+
+class FrameInfo {
+  public:
+    FrameInfo() { mappings = NULL; numMappings = 0; text = NULL; }
+
+    void AddMapping(AddrSpace *space, int vpn, TranslationEntry *entry);
+					// Record that a page is in the frame
+    void RemoveMapping(AddrSpace *space, int vpn);
+					// Record that it no longer is
+    bool IsFree() { return mappings == NULL; }
+    bool IsShared() { return numMappings > 1; }
+
+    bool Used();		// Has any page in the frame been used?
+    bool Dirty();		// Or modified?
+    void ClearUse();		// Clear the use bits of all the pages
+
+    FrameMapping *mappings;	// the pages in the frame, or NULL if
+				// the frame is free
+    int numMappings;		// how many there are
+    TextSegment *text;		// the shared code the frame holds a
+				// page of, or NULL
+};
+
+// The following class keeps the numbers of the free frames on stacks,
+// so that a frame is allocated or freed in constant time, however much
+// physical memory there is.
+//
+// Free frames known to be filled with zeroes are kept on a stack of
+// their own, so that a page that starts out zero can be given one
+// without zeroing it then.  Frames are zeroed ahead of time, by
+// ZeroFrame, when the machine is idle.
+
+#define ZeroBatch	8		// frames zeroed each time the
+					// machine idles
+
+class FrameAllocator {
+  public:
+    FrameAllocator(int nFrames);	// Initially, every frame is free,
+					// and zero
+    ~FrameAllocator();
+
+    int Allocate(bool wantZero);	// Return a free frame, or -1 if
+					// there are none; a zeroed one if
+					// "wantZero" and there is one
+    bool IsZeroed(int frame) { return zeroed[frame]; }
+					// Was "frame" zero when allocated?
+    void Free(int frame);		// Return a frame to the stacks
+    bool ZeroFrame();			// Zero one free frame; FALSE if
+					// they all are zero already
+    int NumFree() { return numDirty + numZero; }
+
+  private:
+    int *dirtyFrames;			// free frames that may hold old data
+    int numDirty;			// how many there are
+    int *zeroFrames;			// free frames holding only zeroes
+    int numZero;			// how many there are
+    bool *zeroed;			// is each frame on zeroFrames, or
+					// allocated from it and unused?
+    int numFrames;			// how many frames there are
+};
+
+// The available replacement policies.
+
+enum ReplacementPolicy { ClockPolicy,	// one hand, sweeping use bits
+			 SecondChancePolicy,	// FIFO, but a used page
+						// goes to the back
+			 NRUPolicy,	// enhanced clock: prefer unused,
+					// then clean pages
+			 WorkingSetPolicy	// WSClock: evict pages outside
+						// the working set window
+};
+
+#define WorkingSetWindow	5000	// ticks a page may go unused and
+					// still be in the working set
+
+// The following class defines the interface of a replacement policy.
+// Every frame is in use whenever ChooseVictim is called.
+
+class PageReplacer {
+  public:
+    PageReplacer(FrameInfo *frames, int numFrames);
+    virtual ~PageReplacer() {}
+
+    virtual void Loaded(int frame) {}	// A page was loaded into "frame"
+    virtual int ChooseVictim() = 0;	// Return the frame to evict
+
+  protected:
+    FrameInfo *frames;		// the frame table
+    int numFrames;		// how many frames there are
+    int hand;			// the clock hand, for policies that
+				// sweep the frames in order
+};
+
+class ClockReplacer : public PageReplacer {
+  public:
+    ClockReplacer(FrameInfo *f, int n) : PageReplacer(f, n) {}
+    int ChooseVictim();
+};
+
+class SecondChanceReplacer : public PageReplacer {
+  public:
+    SecondChanceReplacer(FrameInfo *f, int n);
+    ~SecondChanceReplacer();
+    void Loaded(int frame);
+    int ChooseVictim();
+
+  private:
+    int *queue;			// frames, in the order they were loaded
+    bool *queued;		// is a frame in "queue"?
+    int head, count;		// circular queue
+};
+
+class NRUReplacer : public PageReplacer {
+  public:
+    NRUReplacer(FrameInfo *f, int n) : PageReplacer(f, n) {}
+    int ChooseVictim();
+};
+
+class WorkingSetReplacer : public PageReplacer {
+  public:
+    WorkingSetReplacer(FrameInfo *f, int n);
+    ~WorkingSetReplacer();
+    void Loaded(int frame);
+    int ChooseVictim();
+
+  private:
+    int *lastUse;		// when each frame's page was last
+				// seen to be used
+};
+
+extern PageReplacer *NewPageReplacer(ReplacementPolicy policy,
+				FrameInfo *frames, int numFrames);
+					// Create a replacer for a policy
+
+#endif // REPLACE_H
@@ -0,0 +1,138 @@
+// swap.cc
+//	Routines to manage the swap space, where the contents of pages
+//	evicted from physical memory are kept.
+//
+//	The swap files are created when the swap space is, which
+//	AddrSpace does the first time it has to evict a dirty page.  If
+//	the disk or its directory fills up, we make do with fewer files,
+//	or none; then every Allocate fails, as if the swap space were
+//	full.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "system.h"
+#include "swap.h"
+
+//----------------------------------------------------------------------
+// SwapFileName
+// 	Return the name of swap file "which", in a static buffer.
+//----------------------------------------------------------------------
+
+static char *
+SwapFileName(int which)
+{
+    static char name[16];
+
+    sprintf(name, "SWAP%d", which);
+    return name;
+}
+
+//----------------------------------------------------------------------
+// SwapSpace::SwapSpace
+// 	Create the swap files, replacing any left over from an earlier
+//	run, and mark every slot free.
+//----------------------------------------------------------------------
+
+SwapSpace::SwapSpace()
+{
+    ASSERT(SwapFilePages > 0);		// a page must fit in a file
+    for (numFiles = 0; numFiles < NumSwapFiles; numFiles++) {
+	char *name = SwapFileName(numFiles);
+
+	fileSystem->Remove(name);
+	if (!fileSystem->Create(name, SwapFilePages * PageSize))
+	    break;
+	files[numFiles] = fileSystem->Open(name);
+    }
+    DEBUG('a', "Swap space: %d files, %d pages\n", numFiles,
+					numFiles * SwapFilePages);
+    slotMap = new BitMap(numFiles * SwapFilePages);
+    slotRefs = new int[numFiles * SwapFilePages];
+}
+
+//----------------------------------------------------------------------
+// SwapSpace::~SwapSpace
+// 	Close and remove the swap files.
+//----------------------------------------------------------------------
+
+SwapSpace::~SwapSpace()
+{
+    for (int i = 0; i < numFiles; i++) {
+	delete files[i];
+	fileSystem->Remove(SwapFileName(i));
+    }
+    delete slotMap;
+    delete [] slotRefs;
+}
+
+//----------------------------------------------------------------------
+// SwapSpace::Allocate
+// 	Reserve a slot to hold one page.  Returns -1 if the swap space is
+//	full.
+//----------------------------------------------------------------------
+
+int
+SwapSpace::Allocate()
+{
+    int slot = slotMap->Find();
+
+    if (slot >= 0)
+	slotRefs[slot] = 1;
+    return slot;
+}
+
+//----------------------------------------------------------------------
+// SwapSpace::Share
+// 	Add a reference to a slot, for another page with the same
+//	contents.
+//----------------------------------------------------------------------
+
+void
+SwapSpace::Share(int slot)
+{
+    ASSERT(slotRefs[slot] > 0);
+    slotRefs[slot]++;
+}
+
+//----------------------------------------------------------------------
+// SwapSpace::Free
+// 	Release a reference to a slot.  When the last one goes, the
+//	contents are no longer needed, and the slot is free.
+//----------------------------------------------------------------------
+
+void
+SwapSpace::Free(int slot)
+{
+    ASSERT(slotRefs[slot] > 0);
+    if (--slotRefs[slot] == 0)
+	slotMap->Clear(slot);
+}
+
+//----------------------------------------------------------------------
+// SwapSpace::ReadPage
+// SwapSpace::WritePage
+// 	Transfer one page between memory and a slot.  The caller blocks
+//	until the disk is done.
+//
+//	"slot" -- the slot, from Allocate
+//	"into"/"from" -- the page in memory
+//----------------------------------------------------------------------
+
+void
+SwapSpace::ReadPage(int slot, char *into)
+{
+    DEBUG('a', "Reading swap slot %d\n", slot);
+    files[slot / SwapFilePages]->ReadAt(into, PageSize,
+					(slot % SwapFilePages) * PageSize);
+}
+
+void
+SwapSpace::WritePage(int slot, char *from)
+{
+    DEBUG('a', "Writing swap slot %d\n", slot);
+    files[slot / SwapFilePages]->WriteAt(from, PageSize,
+					(slot % SwapFilePages) * PageSize);
+}
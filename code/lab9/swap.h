@@ -0,0 +1,53 @@
+// swap.h
+//	Data structures for the swap space: the place on the Nachos disk
+//	where pages evicted from physical memory are kept until they
+//	are needed again.
+//
+//	The swap space is a set of ordinary Nachos files, "SWAP0",
+//	"SWAP1", ..., each created at the largest size a file can have.
+//	It is divided into page-sized slots, which are handed out to
+//	address spaces one page at a time.  A cloned address space shares
+//	its parent's slots, so each slot has a reference count, and is
+//	only free once every page using it has let it go.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef SWAP_H
+#define SWAP_H
+
+#include "copyright.h"
+#include "openfile.h"
+#include "bitmap.h"
+#include "filehdr.h"
+
+#define NumSwapFiles	4			// at most this many files
+#define SwapFilePages	(MaxFileSize / PageSize)	// slots per file
+
+// The following class defines the swap space.  Slots are numbered from
+// 0; slot "n" is page (n % SwapFilePages) of file (n / SwapFilePages).
+
+class SwapSpace {
+  public:
+    SwapSpace();			// Create the swap files
+    ~SwapSpace();			// Close and remove them
+
+    int Allocate();			// Reserve a slot; return -1 if
+					// the swap space is full
+    void Share(int slot);		// Add a reference to a slot
+    void Free(int slot);		// Release a reference to a slot
+    bool IsShared(int slot) { return slotRefs[slot] > 1; }
+					// Does anyone else use this slot?
+
+    void ReadPage(int slot, char *into);	// Read or write the page
+    void WritePage(int slot, char *from);	// stored in a slot
+
+  private:
+    OpenFile *files[NumSwapFiles];	// the swap files
+    int numFiles;			// how many could be created
+    BitMap *slotMap;			// which slots are in use
+    int *slotRefs;			// how many pages use each slot
+};
+
+#endif // SWAP_H
@@ -1,25 +1,35 @@
-// synchdisk.cc 
-//	Routines to synchronously access the disk.  The physical disk 
+// synchdisk.cc
+//	Routines to synchronously access the disk.  The physical disk
 //	is an asynchronous device (disk requests return immediately, and
 //	an interrupt happens later on).  This is a layer on top of
 //	the disk providing a synchronous interface (requests wait until
 //	the request completes).
 //
-//	Use a semaphore to synchronize the interrupt handlers with the
-//	pending requests.  And, because the physical disk can only
-//	handle one operation at a time, use a lock to enforce mutual
-//	exclusion.
+//	The physical disk can only handle one operation at a time, so
+//	requests wait on a queue; when one finishes, the interrupt handler
+//	starts the next, and calls the finished request's callback.  A
+//	thread that needs a sector waits on a semaphore of the cache
+//	buffer it is going into, which the callback signals; other threads
+//	go on using the cache meanwhile.  The cache is only changed with
+//	interrupts disabled, since callbacks change it too.
+//
+//	Sectors are kept in a write-back cache.  Dirty sectors are written
+//	when their buffer is needed for another sector, on Flush (the Halt
+//	system call does one), and, a sector at a time, whenever the
+//	machine is idle and the disk isn't busy.  So by the time Nachos
+//	halts for lack of anything to do, the disk is up to date.
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
-// All rights reserved.  See copyright.h for copyright notice and limitation 
+// All rights reserved.  See copyright.h for copyright notice and limitation
 // of liability and disclaimer of warranty provisions.
 
 #include "copyright.h"
+#include "system.h"
 #include "synchdisk.h"
 
 //----------------------------------------------------------------------
 // DiskRequestDone
-// 	Disk interrupt handler.  Need this to be a C routine, because 
+// 	Disk interrupt handler.  Need this to be a C routine, because
 //	C++ can't handle pointers to member functions.
 //----------------------------------------------------------------------
 
@@ -31,33 +41,146 @@ DiskRequestDone (_int arg)
     dsk->RequestDone();					// disk -> dsk
 }
 
+//----------------------------------------------------------------------
+// DiskIdle
+// 	Idle handler: write a dirty sector back while there is nothing
+//	else to do.
+//----------------------------------------------------------------------
+
+static void
+DiskIdle(_int arg)
+{
+    SynchDisk* dsk = (SynchDisk *)arg;
+
+    dsk->WriteBehind();
+}
+
+//----------------------------------------------------------------------
+// BufferIODone
+// 	Callback for the request of a run of cache buffers.
+//----------------------------------------------------------------------
+
+static void
+BufferIODone(_int arg)
+{
+    BufferRequest *request = (BufferRequest *)arg;
+
+    request->cache->RunDone(request);
+}
+
+//----------------------------------------------------------------------
+// CanWriteBack
+// 	Return TRUE if "buf" is a dirty buffer no one is using, that can
+//	join a run being written back.
+//----------------------------------------------------------------------
+
+static bool
+CanWriteBack(SectorBuffer *buf)
+{
+    return buf != NULL && buf->dirty && buf->pinCount == 0 && !buf->writing;
+}
+
+//----------------------------------------------------------------------
+// SectorBuffer::SectorBuffer
+// 	Initialize an empty cache buffer.
+//----------------------------------------------------------------------
+
+SectorBuffer::SectorBuffer()
+{
+    sector = -1;
+    dirty = filling = writing = readAhead = FALSE;
+    pinCount = numWaiting = 0;
+    ioDone = new Semaphore("sector buffer", 0);
+    hashNext = prev = next = NULL;
+}
+
+SectorBuffer::~SectorBuffer()
+{
+    delete ioDone;
+}
+
+//----------------------------------------------------------------------
+// SectorBuffer::Wait
+// 	Sleep until the buffer's request finishes.  The caller checks
+//	again what it was waiting for.  Called with interrupts disabled.
+//----------------------------------------------------------------------
+
+void
+SectorBuffer::Wait()
+{
+    numWaiting++;
+    ioDone->P();
+}
+
+//----------------------------------------------------------------------
+// SectorBuffer::IODone
+// 	The buffer's request has finished: the sector is now in "data",
+//	or on the disk.  Wake up everyone waiting for it.
+//
+//	"wrote" -- TRUE if the request was a write
+//----------------------------------------------------------------------
+
+void
+SectorBuffer::IODone(bool wrote)
+{
+    if (wrote)
+	writing = FALSE;
+    else
+	filling = FALSE;
+    for (; numWaiting > 0; numWaiting--)
+	ioDone->V();
+}
+
 //----------------------------------------------------------------------
 // SynchDisk::SynchDisk
 // 	Initialize the synchronous interface to the physical disk, in turn
-//	initializing the physical disk.
+//	initializing the physical disk.  The cache starts out empty.
 //
 //	"name" -- UNIX file name to be used as storage for the disk data
 //	   (usually, "DISK")
+//	"cacheSectors" -- how many sectors to cache
+//	"policy" -- the order to do waiting requests in
 //----------------------------------------------------------------------
 
-SynchDisk::SynchDisk(char* name)
+SynchDisk::SynchDisk(char* name, int cacheSectors, DiskPolicy policy)
 {
-    semaphore = new Semaphore("synch disk", 0);
-    lock = new Lock("synch disk lock");
+    ASSERT(cacheSectors > 0);
     disk = new Disk(name, DiskRequestDone, (_int) this);
+    active = NULL;
+    scheduler = NewDiskScheduler(policy, disk);
+    headSector = 0;			// where the Disk starts out
+
+    numBuffers = cacheSectors;
+    maxRun = min(max(numBuffers / 4, 1), MaxRunSectors);
+    numPinned = 0;
+    bufferFree = new Semaphore("free sector buffer", 0);
+    numWaitingForBuffer = 0;
+    buffers = new SectorBuffer[numBuffers];
+    hashTable = new SectorBuffer *[numBuffers];
+    for (int i = 0; i < numBuffers; i++) {
+	buffers[i].prev = (i > 0) ? &buffers[i - 1] : NULL;
+	buffers[i].next = (i < numBuffers - 1) ? &buffers[i + 1] : NULL;
+	hashTable[i] = NULL;
+    }
+    mostRecent = &buffers[0];
+    leastRecent = &buffers[numBuffers - 1];
+    interrupt->AddIdleHandler(DiskIdle, (_int) this);
 }
 
 //----------------------------------------------------------------------
 // SynchDisk::~SynchDisk
 // 	De-allocate data structures needed for the synchronous disk
-//	abstraction.
+//	abstraction.  Dirty sectors were written before Nachos halted;
+//	only if it was killed are they lost.
 //----------------------------------------------------------------------
 
 SynchDisk::~SynchDisk()
 {
+    delete scheduler;
     delete disk;
-    delete lock;
-    delete semaphore;
+    delete [] buffers;
+    delete [] hashTable;
+    delete bufferFree;
 }
 
 //----------------------------------------------------------------------
@@ -72,16 +195,14 @@ SynchDisk::~SynchDisk()
 void
 SynchDisk::ReadSector(int sectorNumber, char* data)
 {
-    lock->Acquire();			// only one disk I/O at a time
-    disk->ReadRequest(sectorNumber, data);
-    semaphore->P();			// wait for interrupt
-    lock->Release();
+    bcopy(PinSector(sectorNumber, FALSE), data, SectorSize);
+    UnpinSector(sectorNumber, FALSE);
 }
 
 //----------------------------------------------------------------------
 // SynchDisk::WriteSector
-// 	Write the contents of a buffer into a disk sector.  Return only
-//	after the data has been written.
+// 	Write the contents of a buffer into a disk sector.  The sector
+//	reaches the disk later; see Flush.
 //
 //	"sectorNumber" -- the disk sector to be written
 //	"data" -- the new contents of the disk sector
@@ -90,20 +211,541 @@ SynchDisk::ReadSector(int sectorNumber, char* data)
 void
 SynchDisk::WriteSector(int sectorNumber, char* data)
 {
-    lock->Acquire();			// only one disk I/O at a time
-    disk->WriteRequest(sectorNumber, data);
-    semaphore->P();			// wait for interrupt
-    lock->Release();
+    bcopy(data, PinSector(sectorNumber, TRUE), SectorSize);
+    UnpinSector(sectorNumber, TRUE);
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::ReadSectors
+// 	Read the contents of consecutive disk sectors into a buffer,
+//	through the cache.  Each run of them that isn't cached is read with
+//	one disk request, rather than one per sector.  Return only after
+//	they have all been read.
+//
+//	At most maxRun sectors are pinned at a time, so that a long read
+//	leaves buffers for everyone else, and fewer if that would pin the
+//	last unpinned buffer: we would wait in Replace for someone to
+//	unpin one while holding our own.  A buffer is marked filling as
+//	soon as it is taken, in case we wait in Replace for a write
+//	before its run is queued.
+//
+//	"sectorNumber" -- the first disk sector to read
+//	"numSectors" -- how many sectors to read
+//	"data" -- the buffer to hold their contents
+//----------------------------------------------------------------------
+
+void
+SynchDisk::ReadSectors(int sectorNumber, int numSectors, char* data)
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+    SectorBuffer *pinned[MaxRunSectors], *run[MaxRunSectors], *buf;
+    int count, runLength, i;
+
+    for (; numSectors > 0; numSectors -= count) {
+	count = min(numSectors, maxRun);
+	runLength = 0;
+	for (i = 0; i < count; ) {
+	    buf = Lookup(sectorNumber + i);
+	    if (buf != NULL) {
+		stats->numCacheHits++;
+		StartIO(run, runLength, FALSE);	// the run ends here
+		runLength = 0;
+	    } else if (i > 0 && numPinned >= numBuffers - 1) {
+		count = i;			// do these first
+		break;
+	    } else if ((buf = Replace(sectorNumber + i)) != NULL) {
+		stats->numCacheMisses++;
+		buf->filling = TRUE;
+		run[runLength++] = buf;
+	    } else
+		continue;			// look again
+	    Pin(buf);
+	    MakeMostRecent(buf);
+	    pinned[i++] = buf;
+	}
+	StartIO(run, runLength, FALSE);
+	for (i = 0; i < count; i++) {
+	    while (pinned[i]->filling)
+		pinned[i]->Wait();
+	    bcopy(pinned[i]->data, data + i * SectorSize, SectorSize);
+	    Unpin(pinned[i]);
+	}
+	sectorNumber += count;
+	data += count * SectorSize;
+    }
+    (void) interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::PinSector
+// 	Return the cache's copy of a sector, reading it from the disk if
+//	it isn't cached.  The caller may read or change the copy in place,
+//	until it calls UnpinSector; until then, the buffer isn't reused.
+//
+//	If the sector is still being read in, for another thread or by
+//	ReadAhead, wait for it.  If we have to wait for a buffer to be
+//	written back before we can reuse it, someone else may have
+//	brought the sector in meanwhile, so look again.
+//
+//	"sectorNumber" -- the disk sector
+//	"overwrite" -- TRUE if the caller is going to replace the whole
+//		sector, so there is no need to read it; until it is
+//		unpinned, anyone else wanting it waits
+//----------------------------------------------------------------------
+
+char *
+SynchDisk::PinSector(int sectorNumber, bool overwrite)
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+    SectorBuffer *buf;
+
+    for (;;) {
+	buf = Lookup(sectorNumber);
+	if (buf != NULL) {
+	    stats->numCacheHits++;
+	    Pin(buf);
+	    while (buf->filling)
+		buf->Wait();
+	    break;
+	}
+	buf = Replace(sectorNumber);
+	if (buf != NULL) {
+	    stats->numCacheMisses++;
+	    Pin(buf);
+	    if (overwrite)
+		buf->filling = TRUE;
+	    else {
+		StartIO(&buf, 1, FALSE);
+		while (buf->filling)
+		    buf->Wait();
+	    }
+	    break;
+	}
+    }
+    MakeMostRecent(buf);
+    (void) interrupt->SetLevel(oldLevel);
+    return buf->data;
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::UnpinSector
+// 	The caller is done with the copy of a sector from PinSector.  If
+//	it was pinned to be overwritten, it is now there for everyone.
+//
+//	"sectorNumber" -- the disk sector
+//	"dirty" -- TRUE if the caller changed it
+//----------------------------------------------------------------------
+
+void
+SynchDisk::UnpinSector(int sectorNumber, bool dirty)
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+    SectorBuffer *buf = Lookup(sectorNumber);
+
+    ASSERT(buf != NULL && buf->pinCount > 0);
+    Unpin(buf);
+    if (dirty)
+	buf->dirty = TRUE;
+    if (buf->filling) {			// we were copying it in
+	buf->filling = FALSE;
+	for (; buf->numWaiting > 0; buf->numWaiting--)
+	    buf->ioDone->V();
+    }
+    (void) interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::ReadAhead
+// 	Start reading consecutive sectors into the cache, skipping those
+//	cached already, and return without waiting.  Each sector goes into
+//	the least recently used clean buffer that no one is using; if there
+//	is none, or it is the last unpinned buffer, it is simply not read
+//	ahead.  The sectors that are read go in runs, as for ReadSectors.
+//
+//	"sectorNumber" -- the first disk sector to read
+//	"numSectors" -- how many sectors to read
+//----------------------------------------------------------------------
+
+void
+SynchDisk::ReadAhead(int sectorNumber, int numSectors)
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+    SectorBuffer *run[MaxRunSectors], *buf;
+    int runLength = 0;
+
+    for (int i = 0; i < numSectors; i++) {
+	buf = NULL;
+	if (Lookup(sectorNumber + i) == NULL && numPinned < numBuffers - 1)
+	    for (buf = leastRecent; buf != NULL; buf = buf->prev)
+		if (buf->pinCount == 0 && !buf->dirty && !buf->writing)
+		    break;
+	if (buf == NULL || runLength == maxRun) {
+	    StartIO(run, runLength, FALSE);	// the run ends here
+	    runLength = 0;
+	}
+	if (buf == NULL)
+	    continue;
+	DEBUG('f', "Reading ahead sector %d\n", sectorNumber + i);
+	Rename(buf, sectorNumber + i);
+	MakeMostRecent(buf);
+	Pin(buf);			// until RunDone
+	buf->readAhead = TRUE;
+	run[runLength++] = buf;
+	stats->numReadAheads++;
+    }
+    StartIO(run, runLength, FALSE);
+    (void) interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::SpareBuffers
+// 	Return how many buffers can be given to reading ahead without
+//	crowding out the rest of the cache: half of those no one is
+//	using.  The others keep what was used recently, and leave room
+//	for the sectors callers are waiting for.
+//----------------------------------------------------------------------
+
+int
+SynchDisk::SpareBuffers()
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+    int spare = (numBuffers - numPinned) / 2;
+
+    (void) interrupt->SetLevel(oldLevel);
+    return spare;
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::Flush
+// 	Write every dirty sector in the cache to the disk.  Return only
+//	after they have been written.  All the writes are queued before
+//	we wait for any of them.
+//----------------------------------------------------------------------
+
+void
+SynchDisk::Flush()
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+    int i;
+
+    for (i = 0; i < numBuffers; i++) {
+	while (buffers[i].dirty && buffers[i].writing)
+	    buffers[i].Wait();		// changed since it was queued
+	if (buffers[i].dirty)
+	    WriteBack(&buffers[i]);
+    }
+    for (i = 0; i < numBuffers; i++)
+	while (buffers[i].writing)
+	    buffers[i].Wait();
+    (void) interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::WriteBehind
+// 	If the disk has nothing to do, start writing the least recently
+//	used dirty sector back, and return TRUE.  No one waits for the
+//	write.  Called when the machine is idle, with interrupts disabled.
+//----------------------------------------------------------------------
+
+bool
+SynchDisk::WriteBehind()
+{
+    SectorBuffer *buf;
+
+    if (active != NULL)
+	return FALSE;
+    for (buf = leastRecent; buf != NULL; buf = buf->prev)
+	if (buf->dirty && buf->pinCount == 0 && !buf->writing)
+	    break;
+    if (buf == NULL)
+	return FALSE;
+    DEBUG('f', "Writing back sector %d while idle\n", buf->sector);
+    WriteBack(buf);
+    stats->numWriteBehinds++;
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::Submit
+// 	Put a request on the disk queue, and start it if the disk is free.
+//	Return without waiting; "request->callWhenDone" is called when it
+//	is done.
+//----------------------------------------------------------------------
+
+void
+SynchDisk::Submit(DiskRequest *request)
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+
+    request->queuedAt = stats->totalTicks;
+    scheduler->Add(request);
+    if (active == NULL)
+	StartNext();
+    (void) interrupt->SetLevel(oldLevel);
 }
 
 //----------------------------------------------------------------------
 // SynchDisk::RequestDone
-// 	Disk interrupt handler.  Wake up any thread waiting for the disk
-//	request to finish.
+// 	Disk interrupt handler.  Keep the disk busy with the next request,
+//	then tell whoever made the one that finished.
 //----------------------------------------------------------------------
 
 void
 SynchDisk::RequestDone()
-{ 
-    semaphore->V();
+{
+    DiskRequest *done = active;
+
+    ASSERT(done != NULL);
+    stats->diskWaitTicks += stats->totalTicks - done->queuedAt;
+    active = NULL;
+    StartNext();
+    (*done->callWhenDone)(done->callArg);
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::RunDone
+// 	A request for a run of buffers has finished.  Let the waiting
+//	threads know, and unpin the buffers read ahead, which were pinned
+//	to keep them until the read was done.
+//----------------------------------------------------------------------
+
+void
+SynchDisk::RunDone(BufferRequest *request)
+{
+    SectorBuffer *buf;
+
+    for (int i = 0; i < request->numSectors; i++) {
+	buf = request->buffers[i];
+	if (buf->readAhead && !request->writing) {
+	    buf->readAhead = FALSE;
+	    Unpin(buf);
+	}
+	buf->IODone(request->writing);
+    }
+    delete request;
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::StartNext
+// 	Give the disk the waiting request the scheduler picks, if there
+//	is one.  Called with interrupts disabled, when the disk is free.
+//----------------------------------------------------------------------
+
+void
+SynchDisk::StartNext()
+{
+    int tracks;
+
+    active = scheduler->Next(headSector);
+    if (active == NULL)
+	return;
+    tracks = active->sector / SectorsPerTrack - headSector / SectorsPerTrack;
+    stats->diskSeekTracks += (tracks < 0) ? -tracks : tracks;
+    headSector = active->sector + active->numSectors - 1;
+    if (active->writing)
+	disk->WriteRequest(active->sector, active->numSectors, active->data);
+    else
+	disk->ReadRequest(active->sector, active->numSectors, active->data);
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::StartIO
+// 	Queue one request to read the sectors of a run of buffers into
+//	them, or write them from them.  Called with interrupts disabled.
+//
+//	"run" -- the buffers, of consecutive sectors in order
+//	"count" -- how many; if none, there is nothing to do
+//	"writing" -- TRUE to write them
+//----------------------------------------------------------------------
+
+void
+SynchDisk::StartIO(SectorBuffer **run, int count, bool writing)
+{
+    BufferRequest *request;
+
+    if (count == 0)
+	return;
+    ASSERT(count <= MaxRunSectors);
+    request = new BufferRequest;
+    request->cache = this;
+    request->sector = run[0]->sector;
+    request->numSectors = count;
+    request->writing = writing;
+    for (int i = 0; i < count; i++) {
+	ASSERT(run[i]->sector == request->sector + i);
+	if (writing)
+	    run[i]->writing = TRUE;
+	else
+	    run[i]->filling = TRUE;
+	request->data[i] = run[i]->data;
+	request->buffers[i] = run[i];
+    }
+    request->callWhenDone = BufferIODone;
+    request->callArg = (_int) request;
+    Submit(request);
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::WriteBack
+// 	Queue a write of the dirty sector in "buf", together with the
+//	dirty sectors cached on either side of it that no one is using,
+//	up to maxRun sectors in all, as one request.  They are clean once
+//	queued; a change after that makes them dirty again.  Called with
+//	interrupts disabled.
+//----------------------------------------------------------------------
+
+void
+SynchDisk::WriteBack(SectorBuffer *buf)
+{
+    SectorBuffer *run[MaxRunSectors];
+    int first = buf->sector, count = 1;
+
+    while (count < maxRun && first > 0 && CanWriteBack(Lookup(first - 1))) {
+	first--;
+	count++;
+    }
+    while (count < maxRun && first + count < NumSectors
+			&& CanWriteBack(Lookup(first + count)))
+	count++;
+    for (int i = 0; i < count; i++) {
+	run[i] = Lookup(first + i);
+	run[i]->dirty = FALSE;
+    }
+    StartIO(run, count, TRUE);
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::Pin
+// 	Keep "buf" from being reused, until it is unpinned as many times
+//	as it was pinned.  Called with interrupts disabled.
+//----------------------------------------------------------------------
+
+void
+SynchDisk::Pin(SectorBuffer *buf)
+{
+    if (buf->pinCount++ == 0)
+	numPinned++;
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::Unpin
+// 	Undo one Pin of "buf".  If no one is using it any more, wake up
+//	the threads waiting in Replace for a buffer.  Called with
+//	interrupts disabled.
+//----------------------------------------------------------------------
+
+void
+SynchDisk::Unpin(SectorBuffer *buf)
+{
+    ASSERT(buf->pinCount > 0);
+    if (--buf->pinCount > 0)
+	return;
+    numPinned--;
+    for (; numWaitingForBuffer > 0; numWaitingForBuffer--)
+	bufferFree->V();
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::Lookup
+// 	Return the buffer caching "sectorNumber", or NULL if it isn't
+//	cached.  Called with interrupts disabled.
+//----------------------------------------------------------------------
+
+SectorBuffer *
+SynchDisk::Lookup(int sectorNumber)
+{
+    SectorBuffer *buf;
+
+    for (buf = hashTable[sectorNumber % numBuffers]; buf != NULL;
+						buf = buf->hashNext)
+	if (buf->sector == sectorNumber)
+	    return buf;
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::Replace
+// 	Take the least recently used buffer that no one is using, and make
+//	it the buffer for "sectorNumber".  Its contents are left for the
+//	caller to fill in.  Called with interrupts disabled.
+//
+//	If the buffer is dirty, or every free buffer is being written
+//	back, wait for a write to finish and return NULL; the caller
+//	should look for the sector again.  If every buffer is pinned,
+//	wait for one to be unpinned, then do the same.
+//----------------------------------------------------------------------
+
+SectorBuffer *
+SynchDisk::Replace(int sectorNumber)
+{
+    SectorBuffer *buf;
+
+    for (buf = leastRecent; buf != NULL; buf = buf->prev)
+	if (buf->pinCount == 0 && !buf->writing)
+	    break;
+    if (buf == NULL) {
+	for (buf = leastRecent; buf != NULL; buf = buf->prev)
+	    if (buf->pinCount == 0)
+		break;
+	if (buf != NULL)
+	    buf->Wait();		// it is being written back
+	else {
+	    DEBUG('f', "Waiting for a buffer, for sector %d\n", sectorNumber);
+	    numWaitingForBuffer++;	// every buffer is pinned
+	    bufferFree->P();
+	}
+	return NULL;
+    }
+    if (buf->dirty) {
+	WriteBack(buf);
+	while (buf->writing)
+	    buf->Wait();
+	return NULL;
+    }
+    Rename(buf, sectorNumber);
+    return buf;
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::Rename
+// 	Move "buf" to the hash bucket for "sectorNumber", the sector it is
+//	about to hold.  Called with interrupts disabled.
+//----------------------------------------------------------------------
+
+void
+SynchDisk::Rename(SectorBuffer *buf, int sectorNumber)
+{
+    SectorBuffer **prev;
+
+    if (buf->sector >= 0) {
+	for (prev = &hashTable[buf->sector % numBuffers]; *prev != buf;
+						prev = &(*prev)->hashNext)
+	    ;
+	*prev = buf->hashNext;
+    }
+    buf->sector = sectorNumber;
+    buf->hashNext = hashTable[sectorNumber % numBuffers];
+    hashTable[sectorNumber % numBuffers] = buf;
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::MakeMostRecent
+// 	Move "buf" to the front of the LRU list.  Called with interrupts
+//	disabled.
+//----------------------------------------------------------------------
+
+void
+SynchDisk::MakeMostRecent(SectorBuffer *buf)
+{
+    if (buf == mostRecent)
+	return;
+    buf->prev->next = buf->next;	// not first, so it has a prev
+    if (buf->next != NULL)
+	buf->next->prev = buf->prev;
+    else
+	leastRecent = buf->prev;
+    buf->prev = NULL;
+    buf->next = mostRecent;
+    mostRecent->prev = buf;
+    mostRecent = buf;
 }
@@ -1,9 +1,13 @@
-// synchdisk.h 
-// 	Data structures to export a synchronous interface to the raw 
+// synchdisk.h
+// 	Data structures to export a synchronous interface to the raw
 //	disk device.
 //
+//	Sectors are cached in memory, so that the ones the file system
+//	uses over and over -- the free map, the directory, file headers --
+//	are only read from the disk once.
+//
 // Copyright (c) 1992-1993 The Regents of the University of California.
-// All rights reserved.  See copyright.h for copyright notice and limitation 
+// All rights reserved.  See copyright.h for copyright notice and limitation
 // of liability and disclaimer of warranty provisions.
 
 #include "copyright.h"
@@ -13,6 +17,48 @@
 
 #include "disk.h"
 #include "synch.h"
+#include "disksched.h"
+
+#define DefaultCacheSectors	64	// sectors cached, unless set with
+					// the -dc flag (see main.cc)
+
+// The following class is one buffer of the sector cache.  A buffer has
+// at most one request of its own on the disk queue at a time.
+
+class SectorBuffer {
+  public:
+    SectorBuffer();
+    ~SectorBuffer();
+
+    void Wait();		// Sleep until a request for the buffer
+				// finishes; call with interrupts off
+    void IODone(bool wrote);	// Called when one does
+
+    int sector;			// which sector it holds, or -1
+    char data[SectorSize];	// its contents
+    bool dirty;			// modified since it was last written?
+    int pinCount;		// how many callers are using "data"; the
+				// buffer isn't reused until it is 0
+    bool filling;		// is the sector still being read in, or
+				// copied in by whoever pinned it?
+    bool writing;		// is it being written back?
+    bool readAhead;		// is it being read in with no one
+				// waiting for it?
+    Semaphore *ioDone;		// to wait for the request
+    int numWaiting;		// threads waiting on "ioDone"
+    SectorBuffer *hashNext;	// next buffer in the same hash bucket
+    SectorBuffer *prev, *next;	// neighbours on the LRU list
+};
+
+class SynchDisk;
+
+// A request for a run of cache buffers, holding consecutive sectors.
+
+class BufferRequest : public DiskRequest {
+  public:
+    SynchDisk *cache;				// whose buffers they are
+    SectorBuffer *buffers[MaxRunSectors];	// the buffer of each sector
+};
 
 // The following class defines a "synchronous" disk abstraction.
 // As with other I/O devices, the raw physical disk is an asynchronous device --
@@ -24,30 +70,105 @@
 // This class provides the abstraction that for any individual thread
 // making a request, it waits around until the operation finishes before
 // returning.
+//
+// Underneath is an asynchronous interface: requests are queued with
+// Submit, and the disk interrupt handler starts the next one and calls
+// back whoever made the one that finished.  So any number of requests
+// can be outstanding, from any number of threads.  A DiskScheduler
+// picks which of them goes next.
+//
+// Between the callers and the disk is a cache of sector buffers, found
+// by a hash table on the sector number, and kept on a list from the
+// most recently used to the least, which is the one reused on a miss.
+// Writes only change the buffer; a dirty buffer goes to the disk when
+// it is reused, when the machine is idle, or on Flush.  Callers can use
+// a buffer in place by pinning it.  Sectors can also be read ahead:
+// ReadAhead queues a read into the cache, and returns without waiting.
+// Consecutive sectors missing from the cache are read, and consecutive
+// dirty ones are written back, with one request for the run.
+//
+// A thread that needs a buffer when every one is pinned waits for one
+// to be unpinned.  Reading ahead, and pinning a run of buffers, never
+// takes the last unpinned one, so whoever waits is not waiting on a
+// thread that is itself waiting for a buffer.
 class SynchDisk {
   public:
-    SynchDisk(char* name);    		// Initialize a synchronous disk,
+    SynchDisk(char* name, int cacheSectors = DefaultCacheSectors,
+					DiskPolicy policy = FCFSPolicy);
+					// Initialize a synchronous disk,
 					// by initializing the raw Disk.
     ~SynchDisk();			// De-allocate the synch disk data
-    
+
     void ReadSector(int sectorNumber, char* data);
-    					// Read/write a disk sector, returning
-    					// only once the data is actually read 
-					// or written.  These call
-    					// Disk::ReadRequest/WriteRequest and
-					// then wait until the request is done.
+    					// Read/write a disk sector, through
+					// the cache.  A read returns once
+					// the data is in "data", waiting
+					// for the disk if the sector isn't
+					// cached; a write only changes the
+					// cached copy.
     void WriteSector(int sectorNumber, char* data);
-    
+    void ReadSectors(int sectorNumber, int numSectors, char* data);
+					// Read consecutive sectors, the
+					// uncached ones a run at a time
+
+    char *PinSector(int sectorNumber, bool overwrite);
+					// Return the cached copy of a sector,
+					// which stays cached until unpinned;
+					// read it first unless "overwrite"
+    void UnpinSector(int sectorNumber, bool dirty);
+					// Done with it; "dirty" if changed
+    void ReadAhead(int sectorNumber, int numSectors);
+					// Start reading consecutive sectors
+					// into the cache, without waiting
+    int SpareBuffers();			// How many sectors are worth
+					// reading ahead just now
+    void Flush();			// Write every dirty sector to disk
+    bool WriteBehind();			// Start writing one dirty sector,
+					// if the disk has nothing to do
+
+    void Submit(DiskRequest *request);	// Queue a request for the disk,
+					// and return at once
     void RequestDone();			// Called by the disk device interrupt
 					// handler, to signal that the
 					// current disk operation is complete.
+    void RunDone(BufferRequest *request);
+					// Called when a request for a run
+					// of buffers is complete
 
   private:
     Disk *disk;		  		// Raw disk device
-    Semaphore *semaphore; 		// To synchronize requesting thread 
-					// with the interrupt handler
-    Lock *lock;		  		// Only one read/write request
-					// can be sent to the disk at a time
+    DiskRequest *active;		// the request on the disk, or NULL
+    DiskScheduler *scheduler;		// the requests waiting for it
+    int headSector;			// the last sector the disk did
+
+    SectorBuffer *buffers;		// the cache
+    int numBuffers;
+    int maxRun;				// most buffers in one request
+    int numPinned;			// buffers with a pinCount
+    Semaphore *bufferFree;		// to wait for one to be unpinned
+    int numWaitingForBuffer;		// threads waiting on "bufferFree"
+    SectorBuffer **hashTable;		// buffers holding a sector, by
+					// sector number mod numBuffers
+    SectorBuffer *mostRecent;		// the LRU list
+    SectorBuffer *leastRecent;
+
+    void StartNext();			// Give the disk the next request
+    void StartIO(SectorBuffer **run, int count, bool writing);
+					// Queue a request for a run of
+					// buffers, of consecutive sectors
+    void WriteBack(SectorBuffer *buf);	// Queue a write of a dirty buffer,
+					// with its dirty neighbours
+    void Pin(SectorBuffer *buf);		// Keep a buffer from being reused
+    void Unpin(SectorBuffer *buf);	// Undo Pin, waking anyone waiting
+					// for a buffer if it is now free
+    SectorBuffer *Lookup(int sectorNumber);
+					// Find a sector's buffer, or NULL
+    SectorBuffer *Replace(int sectorNumber);
+					// Reuse the least recently used
+					// unpinned buffer for a sector
+    void Rename(SectorBuffer *buf, int sectorNumber);
+					// Rehash a buffer for a new sector
+    void MakeMostRecent(SectorBuffer *buf);
 };
 
 #endif // SYNCHDISK_H
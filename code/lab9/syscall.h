@@ -29,6 +29,7 @@
 #define SC_Close	8
 #define SC_Fork		9
 #define SC_Yield	10
+#define SC_Sbrk		11
 
 #ifndef IN_ASM
 
@@ -114,8 +115,9 @@ void Close(OpenFileId id);
  * threads to run within a user program. 
  */
 
-/* Fork a thread to run a procedure ("func") in the *same* address space 
- * as the current thread.
+/* Fork a thread to run a procedure ("func") in a copy of the current
+ * thread's address space.  The copy is made lazily: the two share every
+ * page until one of them writes to it.
  */
 void Fork(void (*func)());
 
@@ -124,6 +126,17 @@ void Fork(void (*func)());
  */
 void Yield();		
 
+
+/* Memory allocation: Sbrk.  The heap starts out empty, just above the
+ * program's data; the stack needs no call, since it grows by itself.
+ */
+
+/* Grow the heap by "increment" bytes (shrink it, if negative), and return
+ * the old end of the heap, which is the start of the new memory.  The new
+ * memory starts out zero.  Return 0 if the heap can't grow that much.
+ */
+char *Sbrk(int increment);
+
 #endif /* IN_ASM */
 
 #endif /* SYSCALL_H */
@@ -7,6 +7,7 @@
 
 #include "copyright.h"
 #include "system.h"
+#include "filehdr.h"
 
 // This defines *all* of the global data structures used by Nachos.
 // These are all initialized and de-allocated by this file.
@@ -64,6 +65,53 @@ TimerInterruptHandler(_int dummy)
 	interrupt->YieldOnReturn();
 }
 
+#ifdef USER_PROGRAM
+//----------------------------------------------------------------------
+// CheckMemorySize
+// 	Exit with a usage error unless -mem and -pagesize asked for sizes
+//	the kernel can run with: at least one frame, and a page size that
+//	is a power of two, a whole number of disk sectors (pages go to
+//	and from the disk as sectors), and no bigger than a file (pages
+//	are swapped out to files).
+//----------------------------------------------------------------------
+
+static void
+CheckMemorySize()
+{
+    int maxPageSize = MaxFileSize;
+
+    if (numPhysPages <= 0) {
+	fprintf(stderr, "nachos: -mem %d: need at least one frame\n",
+							numPhysPages);
+	Exit(1);
+    }
+    if (pageSize < SectorSize || (pageSize & (pageSize - 1)) != 0
+					|| pageSize > maxPageSize) {
+	fprintf(stderr, "nachos: -pagesize %d: must be a power of two, "
+	    "from %d to %d\n", pageSize, SectorSize, maxPageSize);
+	Exit(1);
+    }
+}
+#endif
+
+#ifdef FILESYS
+//----------------------------------------------------------------------
+// CheckCacheSize
+// 	Exit with a usage error unless -dc asked for a disk cache of at
+//	least one sector, and no more sectors than the disk has.
+//----------------------------------------------------------------------
+
+static void
+CheckCacheSize(int cacheSectors)
+{
+    if (cacheSectors <= 0 || cacheSectors > NumSectors) {
+	fprintf(stderr, "nachos: -dc %d: must be from 1 to %d\n",
+						cacheSectors, NumSectors);
+	Exit(1);
+    }
+}
+#endif
+
 //----------------------------------------------------------------------
 // Initialize
 // 	Initialize Nachos global data structures.  Interpret command
@@ -83,10 +131,17 @@ Initialize(int argc, char **argv)
 
 #ifdef USER_PROGRAM
     bool debugUserProg = FALSE;	// single step user program
+    bool blockMode = FALSE;	// run user code a basic block at a time
+    bool profile = FALSE;	// count user instructions, print at halt
+    ReplacementPolicy policy = ClockPolicy;	// page replacement
 #endif
 #ifdef FILESYS_NEEDED
     bool format = FALSE;	// format disk
 #endif
+#ifdef FILESYS
+    int cacheSectors = DefaultCacheSectors;	// disk cache size
+    DiskPolicy diskPolicy = FCFSPolicy;		// disk scheduling
+#endif
 #ifdef NETWORK
     double rely = 1;		// network reliability
     double order = 1;           // network orderability
@@ -112,11 +167,69 @@ Initialize(int argc, char **argv)
 #ifdef USER_PROGRAM
 	if (!strcmp(*argv, "-s"))
 	    debugUserProg = TRUE;
+	else if (!strcmp(*argv, "-bb"))
+	    blockMode = TRUE;
+	else if (!strcmp(*argv, "-prof"))
+	    profile = TRUE;
+	else if (!strcmp(*argv, "-mem")) {
+	    ASSERT(argc > 1);
+	    numPhysPages = atoi(*(argv + 1));
+	    CheckMemorySize();
+	    argCount = 2;
+	} else if (!strcmp(*argv, "-pagesize")) {
+	    ASSERT(argc > 1);
+	    pageSize = atoi(*(argv + 1));
+	    CheckMemorySize();
+	    argCount = 2;
+	}
+	else if (!strcmp(*argv, "-rp")) {
+	    ASSERT(argc > 1);
+	    if (!strcmp(*(argv + 1), "clock"))
+		policy = ClockPolicy;
+	    else if (!strcmp(*(argv + 1), "sc"))
+		policy = SecondChancePolicy;
+	    else if (!strcmp(*(argv + 1), "nru"))
+		policy = NRUPolicy;
+	    else if (!strcmp(*(argv + 1), "ws"))
+		policy = WorkingSetPolicy;
+	    else {
+		fprintf(stderr, "nachos: -rp %s: must be clock, sc, nru "
+		    "or ws\n", *(argv + 1));
+		Exit(1);
+	    }
+	    argCount = 2;
+	}
 #endif
 #ifdef FILESYS_NEEDED
 	if (!strcmp(*argv, "-f"))
 	    format = TRUE;
 #endif
+#ifdef FILESYS
+	if (!strcmp(*argv, "-dc")) {
+	    ASSERT(argc > 1);
+	    cacheSectors = atoi(*(argv + 1));
+	    CheckCacheSize(cacheSectors);
+	    argCount = 2;
+	} else if (!strcmp(*argv, "-ds")) {
+	    ASSERT(argc > 1);
+	    if (!strcmp(*(argv + 1), "fcfs"))
+		diskPolicy = FCFSPolicy;
+	    else if (!strcmp(*(argv + 1), "sstf"))
+		diskPolicy = SSTFPolicy;
+	    else if (!strcmp(*(argv + 1), "scan"))
+		diskPolicy = ScanPolicy;
+	    else if (!strcmp(*(argv + 1), "clook"))
+		diskPolicy = CLookPolicy;
+	    else if (!strcmp(*(argv + 1), "rot"))
+		diskPolicy = RotationalPolicy;
+	    else {
+		fprintf(stderr, "nachos: -ds %s: must be fcfs, sstf, scan, "
+		    "clook or rot\n", *(argv + 1));
+		Exit(1);
+	    }
+	    argCount = 2;
+	}
+#endif
 #ifdef NETWORK
 	if (!strcmp(*argv, "-n")) {
 	    ASSERT(argc > 1);
@@ -154,10 +267,14 @@ Initialize(int argc, char **argv)
     
 #ifdef USER_PROGRAM
     machine = new Machine(debugUserProg);	// this must come first
+    machine->SetBlockMode(blockMode);
+    if (profile)
+	machine->StartProfile();
+    AddrSpace::InitPaging(policy);
 #endif
 
 #ifdef FILESYS
-    synchDisk = new SynchDisk("DISK");
+    synchDisk = new SynchDisk("DISK", cacheSectors, diskPolicy);
 #endif
 
 #ifdef FILESYS_NEEDED
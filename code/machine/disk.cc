@@ -28,6 +28,9 @@
 // dummy procedure because we can't take a pointer of a member function
 static void DiskDone(_int arg) { ((Disk *)arg)->HandleInterrupt(); }
 
+// a run of sectors is moved to or from the UNIX file in one piece, here
+static char runBuffer[MaxRunSectors * SectorSize];
+
 //----------------------------------------------------------------------
 // Disk::Disk()
 // 	Initialize a simulated disk.  Open the UNIX file (creating it
@@ -152,6 +155,77 @@ Disk::WriteRequest(int sectorNumber, char* data)
     interrupt->Schedule(DiskDone, (_int) this, ticks, DiskInt);
 }
 
+//----------------------------------------------------------------------
+// Disk::ReadRequest/WriteRequest
+// 	Simulate a request to read/write a run of consecutive sectors,
+//	scattering them into, or gathering them from, separate buffers.
+//	The whole run is done with one interrupt at the end.
+//
+//	"sectorNumber" -- the first disk sector to read/write
+//	"numSectors" -- how many sectors, at most MaxRunSectors
+//	"data" -- the buffer for each sector
+//----------------------------------------------------------------------
+
+void
+Disk::ReadRequest(int sectorNumber, int numSectors, char** data)
+{
+    StartRun(sectorNumber, numSectors, data, FALSE);
+}
+
+void
+Disk::WriteRequest(int sectorNumber, int numSectors, char** data)
+{
+    StartRun(sectorNumber, numSectors, data, TRUE);
+}
+
+//----------------------------------------------------------------------
+// Disk::StartRun
+// 	Do a run request to the UNIX file, with one seek and one read or
+//	write, and set up the interrupt for when it would be done.
+//
+//	After a run onto another track, the track buffer holds that track
+//	from where the run got onto it, its first sector.
+//----------------------------------------------------------------------
+
+void
+Disk::StartRun(int sectorNumber, int numSectors, char** data, bool writing)
+{
+    int ticks = ComputeLatency(sectorNumber, numSectors, writing);
+    int endSector = sectorNumber + numSectors - 1;
+    int i;
+
+    ASSERT(!active);
+    ASSERT((numSectors > 0) && (numSectors <= MaxRunSectors));
+    ASSERT((sectorNumber >= 0) && (endSector < NumSectors));
+
+    DEBUG('d', "%s sectors %d to %d\n", writing ? "Writing" : "Reading",
+						sectorNumber, endSector);
+    Lseek(fileno, SectorSize * sectorNumber + MagicSize, 0);
+    if (writing) {
+	for (i = 0; i < numSectors; i++)
+	    bcopy(data[i], &runBuffer[i * SectorSize], SectorSize);
+	WriteFile(fileno, runBuffer, numSectors * SectorSize);
+	stats->numDiskWrites++;
+    } else {
+	Read(fileno, runBuffer, numSectors * SectorSize);
+	for (i = 0; i < numSectors; i++)
+	    bcopy(&runBuffer[i * SectorSize], data[i], SectorSize);
+	stats->numDiskReads++;
+    }
+    if (DebugIsEnabled('d'))
+	for (i = 0; i < numSectors; i++)
+	    PrintSector(writing, sectorNumber + i, data[i]);
+
+    active = TRUE;
+    UpdateLast(sectorNumber);
+    if (endSector / SectorsPerTrack != sectorNumber / SectorsPerTrack) {
+	bufferInit = stats->totalTicks + ticks
+		- (endSector % SectorsPerTrack + 1) * RotationTime;
+	lastSector = endSector;
+    }
+    interrupt->Schedule(DiskDone, (_int) this, ticks, DiskInt);
+}
+
 //----------------------------------------------------------------------
 // Disk::HandleInterrupt()
 // 	Called when it is time to invoke the disk interrupt handler,
@@ -252,6 +326,36 @@ Disk::ComputeLatency(int newSector, bool writing)
     return(seek + rotation + RotationTime);
 }
 
+//----------------------------------------------------------------------
+// Disk::ComputeLatency()
+// 	Return how long it will take to read/write a run of "numSectors"
+//	sectors starting at "newSector".  Getting to the first one costs
+//	as much as a single sector request; the rest then pass under the
+//	head one per RotationTime, except that moving on to the next track
+//	means seeking one track and waiting for its first sector to come
+//	round.
+//----------------------------------------------------------------------
+
+int
+Disk::ComputeLatency(int newSector, int numSectors, bool writing)
+{
+    int ticks = ComputeLatency(newSector, writing);
+    int sector, when;
+
+    for (sector = newSector + 1; sector < newSector + numSectors; sector++) {
+	if (sector % SectorsPerTrack == 0) {	// on to the next track
+	    ticks += SeekTime;
+	    when = stats->totalTicks + ticks;
+	    if (when % RotationTime > 0)	// to the next sector boundary
+		ticks += RotationTime - when % RotationTime;
+	    when = stats->totalTicks + ticks;
+	    ticks += ModuloDiff(sector, when / RotationTime) * RotationTime;
+	}
+	ticks += RotationTime;
+    }
+    return ticks;
+}
+
 //----------------------------------------------------------------------
 // Disk::UpdateLast
 //   	Keep track of the most recently requested sector.  So we can know
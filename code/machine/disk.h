@@ -45,12 +45,18 @@
 // disks these days now come with a track buffer.
 //
 // The track buffer simulation can be disabled by compiling with -DNOTRACKBUF
+//
+// A request can also cover a run of consecutive sectors, each to or
+// from its own buffer in memory (scatter/gather).  The head seeks once,
+// then the sectors stream past it; only moving on to the next track
+// costs another (one track) seek, and waiting for its first sector.
 
 #define SectorSize 		128	// number of bytes per disk sector
 #define SectorsPerTrack 	32	// number of sectors per disk track 
 #define NumTracks 		32	// number of tracks per disk
 #define NumSectors 		(SectorsPerTrack * NumTracks)
 					// total # of sectors per disk
+#define MaxRunSectors		SectorsPerTrack	// most sectors in one request
 
 class Disk {
   public:
@@ -67,6 +73,12 @@ class Disk {
     					// Only one request allowed at a time!
     void WriteRequest(int sectorNumber, char* data);
 
+    void ReadRequest(int sectorNumber, int numSectors, char** data);
+    void WriteRequest(int sectorNumber, int numSectors, char** data);
+    					// Read/write "numSectors" sectors,
+					// starting at sectorNumber, the i'th
+					// one to/from data[i]
+
     void HandleInterrupt();		// Interrupt handler, invoked when
 					// disk request finishes.
 
@@ -74,6 +86,8 @@ class Disk {
     					// Return how long a request to 
 					// newSector will take: 
 					// (seek + rotational delay + transfer)
+    int ComputeLatency(int newSector, int numSectors, bool writing);
+					// The same, for a run of sectors
 
   private:
     int fileno;				// UNIX file number for simulated disk 
@@ -88,6 +102,8 @@ class Disk {
     int TimeToSeek(int newSector, int *rotate); // time to get to the new track
     int ModuloDiff(int to, int from);        // # sectors between to and from
     void UpdateLast(int newSector);
+    void StartRun(int sectorNumber, int numSectors, char** data,
+							bool writing);
 };
 
 #endif // DISK_H
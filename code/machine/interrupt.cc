@@ -50,6 +50,34 @@ PendingInterrupt::PendingInterrupt(VoidFunctionPtr func, _int param, int time,
     type = kind;
 }
 
+PendingInterrupt *PendingInterrupt::freeList = NULL;
+
+//----------------------------------------------------------------------
+// PendingInterrupt::operator new, operator delete
+// 	Allocate and free PendingInterrupts through a free list, so that
+//	scheduling an interrupt doesn't usually have to call malloc.
+//	Freed PendingInterrupts are never given back to the system.
+//----------------------------------------------------------------------
+
+void *
+PendingInterrupt::operator new(size_t size)
+{
+    PendingInterrupt *p = freeList;
+
+    ASSERT(size == sizeof(PendingInterrupt));
+    if (p == NULL)
+	return ::operator new(size);
+    freeList = p->nextFree;
+    return p;
+}
+
+void
+PendingInterrupt::operator delete(void *p)
+{
+    ((PendingInterrupt *) p)->nextFree = freeList;
+    freeList = (PendingInterrupt *) p;
+}
+
 //----------------------------------------------------------------------
 // Interrupt::Interrupt
 // 	Initialize the simulation of hardware device interrupts.
@@ -60,10 +88,14 @@ PendingInterrupt::PendingInterrupt(VoidFunctionPtr func, _int param, int time,
 Interrupt::Interrupt()
 {
     level = IntOff;
-    pending = new List();
+    maxPending = 16;			// grown as needed
+    pending = new PendingInterrupt *[maxPending];
+    numPending = 0;
+    numScheduled = 0;
     inHandler = FALSE;
     yieldOnReturn = FALSE;
     status = SystemMode;
+    numIdleHandlers = 0;
 }
 
 //----------------------------------------------------------------------
@@ -73,9 +105,9 @@ Interrupt::Interrupt()
 
 Interrupt::~Interrupt()
 {
-    while (!pending->IsEmpty())
-	delete pending->Remove();
-    delete pending;
+    while (numPending > 0)
+	delete RemovePending();
+    delete [] pending;
 }
 
 //----------------------------------------------------------------------
@@ -150,8 +182,6 @@ Interrupt::Enable()
 void
 Interrupt::OneTick()
 {
-    MachineStatus old = status;
-
 // advance simulated time
     if (status == SystemMode) {
         stats->totalTicks += SystemTick;        // SystemTick = 10
@@ -162,6 +192,25 @@ Interrupt::OneTick()
     }
     DEBUG('i', "\n== Tick %d ==\n", stats->totalTicks);
 
+    Poll();
+}
+
+//----------------------------------------------------------------------
+// Interrupt::Poll
+// 	Fire any pending interrupts that are due, without advancing
+//	simulated time, and context switch if a handler asked for it.
+//
+//	Called by OneTick, and directly by the machine emulation when it
+//	has already charged the time for a run of user instructions.
+//----------------------------------------------------------------------
+void
+Interrupt::Poll()
+{
+    MachineStatus old = status;
+
+    if (stats->totalTicks < NextDue())	// nothing to do yet; a handler
+	return;				// must run before any yield
+
 // check any pending interrupts are now ready to fire
     ChangeLevel(IntOn, IntOff);		// first, turn off interrupts
 					// (interrupt handlers run with
@@ -206,12 +255,17 @@ Interrupt::YieldOnReturn()
 //
 //	If there are no pending interrupts, stop.  There's nothing
 //	more for us to do.
+//
+//	First, though, the kernel can use the time for background work,
+//	with idle handlers (see AddIdleHandler).
 //----------------------------------------------------------------------
 void
 Interrupt::Idle()
 {
     DEBUG('i', "Machine idling; checking for interrupts.\n");
     status = IdleMode;
+    for (int i = 0; i < numIdleHandlers; i++)
+	(*idleHandlers[i])(idleArgs[i]);
     if (CheckIfDue(TRUE)) {		// check for any pending interrupts
     	while (CheckIfDue(FALSE))	// check for any other pending 
 	    ;				// interrupts
@@ -233,6 +287,25 @@ Interrupt::Idle()
     Halt();
 }
 
+//----------------------------------------------------------------------
+// Interrupt::AddIdleHandler
+// 	Arrange for "handler" to be called, with "arg", each time the
+//	machine idles.  It is called with interrupts disabled, so it must
+//	not block, and it should do a bounded amount of work -- Idle is
+//	called again the next time there is nothing to run.
+//
+//	A handler may schedule an interrupt, such as a disk request; then
+//	the machine doesn't halt until it is done.
+//----------------------------------------------------------------------
+
+void
+Interrupt::AddIdleHandler(VoidFunctionPtr handler, _int arg)
+{
+    ASSERT(numIdleHandlers < MaxIdleHandlers);
+    idleHandlers[numIdleHandlers] = handler;
+    idleArgs[numIdleHandlers++] = arg;
+}
+
 //----------------------------------------------------------------------
 // Interrupt::Halt
 // 	Shut down Nachos cleanly, printing out performance statistics.
@@ -242,6 +315,10 @@ Interrupt::Halt()
 {
     printf("Machine halting!\n\n");
     stats->Print();
+#ifdef USER_PROGRAM
+    if (machine != NULL)
+	machine->PrintProfile();
+#endif
     Cleanup();     // Never returns.
 }
 
@@ -250,7 +327,8 @@ Interrupt::Halt()
 // 	Arrange for the CPU to be interrupted when simulated time
 //	reaches "now + when".
 //
-//	Implementation: just put it on a sorted list.
+//	Implementation: put it on a heap ordered by time, and for
+//	interrupts due at the same time, by the order they were scheduled.
 //
 //	NOTE: the Nachos kernel should not call this routine directly.
 //	Instead, it is only called by the hardware device simulators.
@@ -271,7 +349,65 @@ Interrupt::Schedule(VoidFunctionPtr handler, _int arg, int fromNow, IntType type
 					intTypeNames[type], when);
     ASSERT(fromNow > 0);
 
-    pending->SortedInsert(toOccur, when);
+    toOccur->order = numScheduled++;
+    InsertPending(toOccur);
+}
+
+//----------------------------------------------------------------------
+// Interrupt::InsertPending
+// 	Add "toOccur" to the heap of pending interrupts, growing the heap
+//	array if it is full, and sift it up into place.
+//----------------------------------------------------------------------
+
+void
+Interrupt::InsertPending(PendingInterrupt *toOccur)
+{
+    int i, parent;
+
+    if (numPending == maxPending) {
+	PendingInterrupt **bigger = new PendingInterrupt *[maxPending * 2];
+
+	for (i = 0; i < numPending; i++)
+	    bigger[i] = pending[i];
+	delete [] pending;
+	pending = bigger;
+	maxPending *= 2;
+    }
+    for (i = numPending++; i > 0; i = parent) {
+	parent = (i - 1) / 2;
+	if (!Before(toOccur, pending[parent]))
+	    break;
+	pending[i] = pending[parent];
+    }
+    pending[i] = toOccur;
+}
+
+//----------------------------------------------------------------------
+// Interrupt::RemovePending
+// 	Remove and return the pending interrupt that is due first, or
+//	NULL if there are none.  The last element of the heap is sifted
+//	down into the hole left at the top.
+//----------------------------------------------------------------------
+
+PendingInterrupt *
+Interrupt::RemovePending()
+{
+    PendingInterrupt *first, *last;
+    int i, child;
+
+    if (numPending == 0)
+	return NULL;
+    first = pending[0];
+    last = pending[--numPending];
+    for (i = 0; (child = 2 * i + 1) < numPending; i = child) {
+	if (child + 1 < numPending && Before(pending[child + 1], pending[child]))
+	    child++;
+	if (!Before(pending[child], last))
+	    break;
+	pending[i] = pending[child];
+    }
+    pending[i] = last;
+    return first;
 }
 
 //----------------------------------------------------------------------
@@ -297,26 +433,23 @@ Interrupt::CheckIfDue(bool advanceClock)
 					// to invoke an interrupt handler
     if (DebugIsEnabled('i'))
 	DumpState();
-    PendingInterrupt *toOccur = 
-		(PendingInterrupt *)pending->SortedRemove(&when);
-
-    if (toOccur == NULL)		// no pending interrupts
+    if (numPending == 0)		// no pending interrupts
 	return FALSE;			
 
-    if (advanceClock && when > stats->totalTicks) {	// advance the clock
+    when = NextDue();
+    if (when > stats->totalTicks && !advanceClock)	// not time yet
+	return FALSE;
+
+    if (when > stats->totalTicks) {		// advance the clock
 	stats->idleTicks += (when - stats->totalTicks);
 	stats->totalTicks = when;
-    } else if (when > stats->totalTicks) {	// not time yet, put it back
-	pending->SortedInsert(toOccur, when);
-	return FALSE;
     }
 
 // Check if there is nothing more to do, and if so, quit
-    if ((status == IdleMode) && (toOccur->type == TimerInt) 
-				&& pending->IsEmpty()) {
-	 pending->SortedInsert(toOccur, when);
+    if ((status == IdleMode) && (pending[0]->type == TimerInt) 
+				&& (numPending == 1))
 	 return FALSE;
-    }
+    PendingInterrupt *toOccur = RemovePending();
 
     DEBUG('i', "Invoking interrupt handler for the %s at time %d\n", 
 			intTypeNames[toOccur->type], toOccur->when);
@@ -363,7 +496,17 @@ Interrupt::DumpState()
 					intLevelNames[level]);
     printf("Pending interrupts:\n");
     fflush(stdout);
-    pending->Mapcar(PrintPending);
+    PendingInterrupt **sorted = new PendingInterrupt *[numPending + 1];
+    int i, j;
+
+    for (i = 0; i < numPending; i++) {	// insertion sort a copy of the
+	for (j = i; j > 0 && Before(pending[i], sorted[j - 1]); j--)
+	    sorted[j] = sorted[j - 1];	// heap, to print in firing order
+	sorted[j] = pending[i];
+    }
+    for (i = 0; i < numPending; i++)
+	PrintPending((_int) sorted[i]);
+    delete [] sorted;
     printf("End of pending interrupts\n");
     fflush(stdout);
 }
@@ -46,15 +46,24 @@ enum IntStatus { IntOff, IntOn };
 // is empty (IdleMode).
 enum MachineStatus {IdleMode, SystemMode, UserMode};
 
+// The most idle handlers the kernel can register (see AddIdleHandler).
+#define MaxIdleHandlers	4
+
 // IntType records which hardware device generated an interrupt.
 // In Nachos, we support a hardware timer device, a disk, a console
 // display and keyboard, and a network.
 enum IntType { TimerInt, DiskInt, ConsoleWriteInt, ConsoleReadInt, 
 				NetworkSendInt, NetworkRecvInt};
 
+#define NeverDue	0x7fffffff	// NextDue when nothing is pending
+
 // The following class defines an interrupt that is scheduled
 // to occur in the future.  The internal data structures are
 // left public to make it simpler to manipulate.
+//
+// Devices schedule and retire interrupts constantly, so freed
+// PendingInterrupts are kept on a free list and reused by "new",
+// rather than going back to the heap each time.
 
 class PendingInterrupt {
   public:
@@ -62,11 +71,20 @@ class PendingInterrupt {
 				// initialize an interrupt that will
 				// occur in the future
 
+    void *operator new(size_t size);	// take one off the free list
+    void operator delete(void *p);	// put it back on the free list
+
     VoidFunctionPtr handler;    // The function (in the hardware device
 				// emulator) to call when the interrupt occurs
     _int arg;           // The argument to the function.
     int when;			// When the interrupt is supposed to fire
     IntType type;		// for debugging
+    unsigned int order;		// when it was scheduled, so interrupts due
+				// at the same time fire in that order
+
+  private:
+    PendingInterrupt *nextFree;	// next on the free list
+    static PendingInterrupt *freeList;	// PendingInterrupts to reuse
 };
 
 // The following class defines the data structures for the simulation
@@ -89,6 +107,9 @@ class Interrupt {
     void Idle(); 			// The ready queue is empty, roll 
 					// simulated time forward until the 
 					// next interrupt
+    void AddIdleHandler(VoidFunctionPtr handler, _int arg);
+					// Have Idle call "handler" first, to
+					// do background work for the kernel
 
     void Halt(); 			// quit and print out stats
     
@@ -111,21 +132,42 @@ class Interrupt {
     					// by the hardware device simulators.
     
     void OneTick();       		// Advance simulated time
+    void Poll();			// Fire any interrupts that are due,
+					// without advancing simulated time
+    int NextDue() { return (numPending > 0) ? pending[0]->when : NeverDue; }
+					// Time the next interrupt is due
 
   private:
     IntStatus level;		// are interrupts enabled or disabled?
-    List *pending;		// the list of interrupts scheduled
-				// to occur in the future
+    PendingInterrupt **pending;	// the interrupts scheduled to occur in
+				// the future, kept as a binary heap
+				// ordered by when, then order
+    int numPending;		// number of interrupts in the heap
+    int maxPending;		// size of the heap array
+    unsigned int numScheduled;	// interrupts scheduled so far, to set
+				// PendingInterrupt::order
     bool inHandler;		// TRUE if we are running an interrupt handler
     bool yieldOnReturn; 	// TRUE if we are to context switch
 				// on return from the interrupt handler
     MachineStatus status;	// idle, kernel mode, user mode
+    VoidFunctionPtr idleHandlers[MaxIdleHandlers];
+				// called by Idle, in order
+    _int idleArgs[MaxIdleHandlers];	// their arguments
+    int numIdleHandlers;	// how many there are
 
     // these functions are internal to the interrupt simulation code
 
     bool CheckIfDue(bool advanceClock); // Check if an interrupt is supposed
 					// to occur now
 
+    void InsertPending(PendingInterrupt *toOccur);
+					// Add an interrupt to the heap
+    PendingInterrupt *RemovePending();	// Remove the earliest one
+    bool Before(PendingInterrupt *a, PendingInterrupt *b)
+	{ return (a->when < b->when) ||
+		((a->when == b->when) && (a->order < b->order)); }
+					// Heap ordering
+
     void ChangeLevel(IntStatus old, 	// SetLevel, without advancing the
 	IntStatus now);  		// simulated time
 };
@@ -44,9 +44,13 @@ void CheckEndian()
 #endif
 }
 
+int pageSize = DefaultPageSize;
+int numPhysPages = DefaultNumPhysPages;
+
 //----------------------------------------------------------------------
 // Machine::Machine
-// 	Initialize the simulation of user program execution.
+// 	Initialize the simulation of user program execution.  Main memory
+//	is allocated for the page size and number of frames chosen at boot.
 //
 //	"debug" -- if TRUE, drop into the debugger after each user instruction
 //		is executed.
@@ -56,22 +60,37 @@ Machine::Machine(bool debug)
 {
     int i;
 
+    ASSERT(PageSize > 0 && PageSize % 4 == 0 && NumPhysPages > 0);
     for (i = 0; i < NumTotalRegs; i++)
         registers[i] = 0;
     mainMemory = new char[MemorySize];
     for (i = 0; i < MemorySize; i++)
       	mainMemory[i] = 0;
-#ifdef USE_TLB
-    tlb = new TranslationEntry[TLBSize];
-    for (i = 0; i < TLBSize; i++)
-	tlb[i].valid = FALSE;
-    pageTable = NULL;
-#else	// use linear page table
+    decodeCache = new Instruction[MemorySize / 4];
+    for (i = 0; i < MemorySize / 4; i++) {
+	decodeCache[i].value = 0;	// matches the zeroed memory
+	decodeCache[i].Decode();
+    }
     tlb = NULL;
+    tlbSize = 0;
+    tlbSlots = NULL;
+    tlbHands = NULL;
+    pageSizes[0] = 1;
+    numPageSizes = 1;
     pageTable = NULL;
-#endif
+#ifdef USE_TLB
+    ConfigureTLB(TLBSize, TLBSize, TLBFifo);
+#endif	// otherwise use linear page table
 
+    FlushHostTLB();
     singleStep = debug;
+    blockMode = FALSE;
+    traceInstructions = DebugIsEnabled('m');
+    traceTicks = DebugIsEnabled('i');
+    unchargedTicks = 0;
+    profiling = FALSE;
+    pcProfile = opProfile = NULL;
+    pcProfileSize = 0;
     CheckEndian();
 }
 
@@ -83,8 +102,110 @@ Machine::Machine(bool debug)
 Machine::~Machine()
 {
     delete [] mainMemory;
-    if (tlb != NULL)
+    delete [] decodeCache;
+    delete [] pcProfile;
+    delete [] opProfile;
+    if (tlb != NULL) {
         delete [] tlb;
+	delete [] tlbSlots;
+	delete [] tlbHands;
+    }
+}
+
+//----------------------------------------------------------------------
+// Machine::ConfigureTLB
+// 	(Re)build the TLB with "size" entries, grouped into sets of "ways"
+//	entries each.  A virtual page can only be loaded into the set
+//	numbered (page # mod number of sets); "ways" == "size" gives a fully
+//	associative TLB, "ways" == 1 a direct-mapped one.  All entries start
+//	out invalid.
+//
+//	"size" -- number of entries, MinTLBSize to MaxTLBSize
+//	"ways" -- entries per set, which must divide "size"
+//	"policy" -- how LoadTLB chooses an entry to replace in a full set
+//----------------------------------------------------------------------
+
+void
+Machine::ConfigureTLB(int size, int ways, TLBPolicy policy)
+{
+    int i;
+
+    ASSERT(size >= MinTLBSize && size <= MaxTLBSize);
+    ASSERT(ways >= 1 && ways <= size && (size % ways) == 0);
+    if (tlb != NULL) {
+	FlushTLB();
+	delete [] tlb;
+	delete [] tlbSlots;
+	delete [] tlbHands;
+    }
+    tlbSize = size;
+    tlbWays = ways;
+    tlbPolicy = policy;
+    tlb = new TranslationEntry[size];
+    tlbSlots = new TLBSlot[size];
+    for (i = 0; i < size; i++) {
+	tlb[i].valid = FALSE;
+	tlbSlots[i].backing = NULL;
+    }
+    tlbHands = new int[size / ways];
+    for (i = 0; i < size / ways; i++)
+	tlbHands[i] = 0;
+    tlbTime = 0;
+}
+
+//----------------------------------------------------------------------
+// Machine::EnableSuperPages
+// 	Let TLB entries map superpages of SmallSuperPage and LargeSuperPage
+//	bytes, as well as single pages.  A superpage size is left out if
+//	it isn't a power-of-two number of pages, or doesn't fit in
+//	physical memory.
+//----------------------------------------------------------------------
+
+void
+Machine::EnableSuperPages()
+{
+    int bytes[NumPageSizes - 1] = { SmallSuperPage, LargeSuperPage };
+
+    numPageSizes = 1;
+    for (int i = 0; i < NumPageSizes - 1; i++) {
+	int pages = bytes[i] / PageSize;
+
+	if (pages > pageSizes[numPageSizes - 1] && pages * PageSize == bytes[i]
+		&& (pages & (pages - 1)) == 0 && pages <= NumPhysPages)
+	    pageSizes[numPageSizes++] = pages;
+    }
+}
+
+//----------------------------------------------------------------------
+// Machine::SuperPageSize
+// 	Return the size, in pages, of the largest superpage the TLB can
+//	map that starts at virtual page "vpn" and ends within "numPages"
+//	pages of it, or 1 if none does.  The kernel must also place the
+//	superpage in a run of that many physical pages, starting at a
+//	multiple of its size.
+//----------------------------------------------------------------------
+
+int
+Machine::SuperPageSize(int vpn, int numPages)
+{
+    for (int i = numPageSizes - 1; i > 0; i--)
+	if (vpn % pageSizes[i] == 0 && pageSizes[i] <= numPages)
+	    return pageSizes[i];
+    return 1;
+}
+
+//----------------------------------------------------------------------
+// Machine::FlushHostTLB
+// 	Invalidate every cached translation.  The kernel must call this
+//	when it installs a different page table, and whenever it changes
+//	an entry (valid, readOnly or physicalPage) of the page table in use.
+//----------------------------------------------------------------------
+
+void
+Machine::FlushHostTLB()
+{
+    for (int i = 0; i < HostTLBSize; i++)
+	hostTLB[i].virtualPage = (unsigned int) -1;
 }
 
 //----------------------------------------------------------------------
@@ -100,15 +221,19 @@ Machine::~Machine()
 void
 Machine::RaiseException(ExceptionType which, int badVAddr)
 {
+    MachineStatus old = interrupt->getStatus();	// SystemMode if the
+						// kernel touched user memory
+
     DEBUG('m', "Exception: %s\n", exceptionNames[which]);
     
 //  ASSERT(interrupt->getStatus() == UserMode);
     registers[BadVAddrReg] = badVAddr;
     DelayedLoad(0, 0);			// finish anything in progress
+    ChargeTicks();			// bring the clock up to date
     interrupt->setStatus(SystemMode);
     ExceptionHandler(which);		// interrupts are enabled at this point
                                         //see userprog/exception.cc
-    interrupt->setStatus(UserMode);
+    interrupt->setStatus(old);
 }
 
 //----------------------------------------------------------------------
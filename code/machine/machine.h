@@ -28,13 +28,32 @@
 
 // Definitions related to the size, and format of user memory
 
-#define PageSize 	SectorSize 	// set the page size equal to
-					// the disk sector size, for
-					// simplicity
+#define DefaultPageSize 	SectorSize 	// set the page size equal to
+						// the disk sector size, for
+						// simplicity
+#define DefaultNumPhysPages	64 //32
 
-#define NumPhysPages    64 //32
+// The page size and the amount of physical memory can be changed when
+// Nachos starts up (see -pagesize and -mem in main.cc), before the
+// Machine is created; after that they must not change.
+
+extern int pageSize;		// bytes in a page; a power of two,
+				// at least SectorSize
+extern int numPhysPages;	// frames of physical memory
+
+#define PageSize 	pageSize
+#define NumPhysPages    numPhysPages
 #define MemorySize 	(NumPhysPages * PageSize)
 #define TLBSize		4		// if there is a TLB, make it small
+					// (the default; see ConfigureTLB)
+#define MinTLBSize	4
+#define MaxTLBSize	256
+#define HostTLBSize	64		// entries in the simulator's own
+					// cache of page table translations
+
+#define NumPageSizes	3		// a TLB entry can map a page, or
+#define SmallSuperPage	4096		// a superpage of one of these
+#define LargeSuperPage	65536		// sizes, in bytes
 
 enum ExceptionType { NoException,           // Everything ok!
 		     SyscallException,      // A program executed a system call.
@@ -91,6 +110,53 @@ class Instruction {
                      // Immediates are sign-extended.
 };
 
+// The following class holds the profiler's counts for one virtual PC,
+// or for one opcode.
+
+class ProfileCount {
+  public:
+    unsigned int executed;	// times an instruction completed here
+    unsigned int taken;		// times it was a branch or jump that
+				// transferred control
+    unsigned int value;		// the instruction word last executed here
+};
+
+// Replacement policies for the TLB, used by Machine::LoadTLB to pick
+// which entry of a set to overwrite when the set is full.
+
+enum TLBPolicy { TLBFifo,		// oldest loaded entry
+		 TLBLru,		// least recently used entry
+		 TLBClock		// first entry not referenced since the
+					// hand last passed it
+};
+
+// The following class holds the simulator's bookkeeping for one TLB entry;
+// it is not visible to user programs.
+
+class TLBSlot {
+  public:
+    TranslationEntry *backing;	// page table entry the TLB entry was
+				// loaded from, to write use/dirty back to
+    unsigned int loadTime;	// when loaded, for FIFO
+    unsigned int useTime;	// when last referenced, for LRU
+    bool referenced;		// referenced since the clock hand passed
+};
+
+// The following class caches recent page table translations as pointers
+// into mainMemory, so that most memory references made by the simulator
+// skip Machine::Translate.  It is not part of the simulated hardware --
+// user programs and the kernel can't tell it is there, except that the
+// kernel must call Machine::FlushHostTLB whenever it changes a page table
+// entry the running program may be using.
+
+class HostTLBEntry {
+  public:
+    unsigned int virtualPage;	// virtual page cached here, or -1
+    TranslationEntry *entry;	// page table entry it was translated by
+    char *page;			// the page's frame in mainMemory
+    bool writable;		// FALSE if the page is read-only
+};
+
 // The following class defines the simulated host workstation hardware, as 
 // seen by user programs -- the CPU registers, main memory, etc.
 // User programs shouldn't be able to tell that they are running on our 
@@ -112,17 +178,59 @@ class Machine {
 
 // Routines callable by the Nachos kernel
     void Run();	 		// Run a user program
+    void SetBlockMode(bool on) { blockMode = on; }
+				// Run user code a basic block at a time,
+				// checking interrupts only between blocks
+    void FlushHostTLB();	// Forget cached page table translations;
+				// call when switching or editing page tables
+    void StartProfile();	// Count every instruction executed, by
+				// PC and by opcode
+    void PrintProfile();	// Print the counts, if profiling
+
+    void ConfigureTLB(int size, int ways, TLBPolicy policy);
+				// Change the shape of the TLB; call before
+				// running any user program
+    void LoadTLB(TranslationEntry *entry);
+				// Load a page table entry into the TLB,
+				// replacing one according to the policy
+    void FlushTLB();		// Invalidate the TLB, copying use and
+				// dirty bits back to the page table
+    void EnableSuperPages();	// Let the TLB hold superpage entries
+    int SuperPageSize(int vpn, int numPages);
+				// Return the number of pages in the
+				// largest superpage that can start at
+				// "vpn" and fit in "numPages" pages; 1
+				// if there is none
 
     int ReadRegister(int num);	// read the contents of a CPU register
 
     void WriteRegister(int num, int value);
 				// store a value into a CPU register
 
+    bool CopyFromUser(int virtAddr, char *into, int numBytes);
+    bool CopyToUser(int virtAddr, char *from, int numBytes);
+				// Copy a buffer out of or into the
+				// virtual memory of the running program.
+				// Return FALSE if an address was bad.
+    int CopyStringFromUser(int virtAddr, char *into, int maxBytes);
+				// Copy a null-terminated string; return
+				// its length, or -1 if it didn't fit
+
 
 // Routines internal to the machine simulation -- DO NOT call these 
 
-    void OneInstruction(Instruction *instr); 	
-    				// Run one instruction of a user program.
+    bool OneInstruction(); 	// Run one instruction of a user program.
+				// Return FALSE if it trapped to the kernel
+    void ProfileInstruction(Instruction *instr, bool taken);
+				// Count the instruction at PCReg
+    void RunBlock();		// Run instructions up to the end of the
+				// current basic block
+    void RunUntilDue();		// Run instructions until an interrupt
+				// is due, charging their time at the end
+    void ChargeTicks();		// Charge the time RunUntilDue has used
+    Instruction *FetchInstruction(int virtAddr);
+				// Translate the PC and return the decoded
+				// instruction there, or NULL on an exception
     void DelayedLoad(int nextReg, int nextVal);  	
 				// Do a pending delayed load (modifying a reg)
     
@@ -138,6 +246,12 @@ class Machine {
 				// the translation entry appropriately,
     				// and return an exception code if the 
 				// translation couldn't be completed.
+    char *CachedTranslate(int virtAddr, int size, bool writing);
+				// Translate through the host TLB; return
+				// NULL if Translate must be called instead
+    char *TranslateSpan(int virtAddr, bool writing, int *spanBytes);
+				// Locate virtAddr in mainMemory, and the
+				// number of bytes left in its page
 
     void RaiseException(ExceptionType which, int badVAddr);
 				// Trap to the Nachos kernel, because of a
@@ -156,6 +270,9 @@ class Machine {
     char *mainMemory;		// physical memory to store user program,
 				// code and data, while executing
     int registers[NumTotalRegs]; // CPU registers, for executing user programs
+    Instruction *decodeCache;	// one predecoded instruction per word of
+				// mainMemory, tagged with the raw word it
+				// was decoded from
 
 
 // NOTE: the hardware translation of virtual addresses in the user program
@@ -183,10 +300,38 @@ class Machine {
     unsigned int pageTableSize;
 
   private:
+    HostTLBEntry hostTLB[HostTLBSize];	// direct-mapped by virtual page #
+
+    int tlbSize;		// number of TLB entries
+    int tlbWays;		// entries per set; tlbSize for a fully
+				// associative TLB
+    TLBPolicy tlbPolicy;	// which entry of a full set to replace
+    TLBSlot *tlbSlots;		// bookkeeping for each TLB entry
+    int *tlbHands;		// clock hand for each set
+    unsigned int tlbTime;	// counts TLB references, for FIFO and LRU
+    int pageSizes[NumPageSizes];	// pages a TLB entry can map,
+					// smallest first
+    int numPageSizes;		// how many of them are in use; 1
+				// until EnableSuperPages is called
+
+    void EvictTLBEntry(int which);	// write back and invalidate an entry
+
     bool singleStep;		// drop back into the debugger after each
 				// simulated instruction
     int runUntilTime;		// drop back into the debugger when simulated
 				// time reaches this value
+    bool blockMode;		// run a basic block between interrupt checks
+    bool traceInstructions;	// print each instruction as it executes;
+				// DebugIsEnabled('m'), looked up once
+    bool traceTicks;		// DebugIsEnabled('i'): print every tick,
+				// so don't batch them in RunUntilDue
+    int unchargedTicks;		// ticks run by RunUntilDue but not yet
+				// added to stats
+
+    bool profiling;		// TRUE once StartProfile is called
+    ProfileCount *pcProfile;	// counts for each word of virtual memory
+    unsigned int pcProfileSize;	// number of words pcProfile covers
+    ProfileCount *opProfile;	// counts for each opcode
 };
 
 extern void ExceptionHandler(ExceptionType which);
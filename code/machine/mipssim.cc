@@ -30,20 +30,99 @@ static void Mult(int a, int b, bool signedArith, int* hiPtr, int* loPtr);
 void
 Machine::Run()
 {
-    Instruction *instr = new Instruction;  // storage for decoded instruction
-
     if(DebugIsEnabled('m'))
         printf("Starting thread \"%s\" at time %d\n",
 	       currentThread->getName(), stats->totalTicks);
     interrupt->setStatus(UserMode);
     for (;;) {
-        OneInstruction(instr);
+	if (blockMode && !singleStep) {
+	    RunBlock();			// time is charged per instruction,
+	    interrupt->Poll();		// but interrupts are only checked
+	    continue;			// between blocks
+	}
+	if (!singleStep && !traceTicks) {
+	    RunUntilDue();		// same timing as the loop below,
+	    interrupt->Poll();		// without a OneTick per instruction
+	    continue;
+	}
+        OneInstruction();
 	interrupt->OneTick();
 	if (singleStep && (runUntilTime <= stats->totalTicks))
 	  Debugger();
     }
 }
 
+//----------------------------------------------------------------------
+// Machine::RunBlock
+// 	Execute one basic block of a user program: a straight-line run of
+//	instructions that ends after the delay slot of a taken branch or
+//	jump, at an instruction that traps to the kernel, or after
+//	MaxBlockSize instructions.
+//
+//	Each instruction is still charged UserTick, exactly as OneTick
+//	would, but Run only checks for pending interrupts once the block
+//	is done.  So interrupts, and with them timer preemption, are
+//	delivered at block boundaries rather than between any two
+//	instructions.
+//----------------------------------------------------------------------
+
+void
+Machine::RunBlock()
+{
+    int pc;
+    bool completed;
+
+    for (int n = 0; n < MaxBlockSize; n++) {
+	pc = registers[PCReg];
+	completed = OneInstruction();
+	stats->totalTicks += UserTick;
+	stats->userTicks += UserTick;
+	if (!completed || (registers[PCReg] != pc + 4))
+	    return;			// trapped, or control transferred
+    }
+}
+
+//----------------------------------------------------------------------
+// Machine::RunUntilDue
+// 	Execute user instructions until the next pending interrupt is due,
+//	or until one traps to the kernel, and then charge their time.
+//
+//	This gives exactly the timing of calling OneTick after every
+//	instruction: Run checks for interrupts at the same tick OneTick
+//	would have fired them, and since RaiseException charges the time
+//	run so far before entering the kernel, the kernel never sees a
+//	stale clock.  At least one instruction is always executed.
+//----------------------------------------------------------------------
+
+void
+Machine::RunUntilDue()
+{
+    int budget = interrupt->NextDue() - stats->totalTicks;
+
+    do {
+	if (!OneInstruction()) {	// the kernel ran, and may have
+	    unchargedTicks += UserTick;	// changed what is pending
+	    break;
+	}
+	unchargedTicks += UserTick;
+    } while (unchargedTicks < budget);
+    ChargeTicks();
+}
+
+//----------------------------------------------------------------------
+// Machine::ChargeTicks
+// 	Add the time of the instructions RunUntilDue has executed so far
+//	to the simulated clock.
+//----------------------------------------------------------------------
+
+void
+Machine::ChargeTicks()
+{
+    stats->totalTicks += unchargedTicks;
+    stats->userTicks += unchargedTicks;
+    unchargedTicks = 0;
+}
+
 
 //----------------------------------------------------------------------
 // TypeToReg
@@ -88,23 +167,24 @@ TypeToReg(RegType reg, Instruction *instr)
 //	leaving.  This allows the Nachos kernel to control our behavior
 //	by controlling the contents of memory, the translation table,
 //	and the register set.
+//
+//	Returns FALSE if the instruction trapped to the kernel, TRUE if
+//	it completed normally.
 //----------------------------------------------------------------------
 
-void
-Machine::OneInstruction(Instruction *instr)
+bool
+Machine::OneInstruction()
 {
-    int raw;
+    Instruction *instr;
     int nextLoadReg = 0; 	
     int nextLoadValue = 0; 	// record delayed load operation, to apply
 				// in the future
 
     // Fetch instruction 
-    if (!machine->ReadMem(registers[PCReg], 4, &raw))
-	return;			// exception occurred
-    instr->value = raw;
-    instr->Decode();
+    if ((instr = FetchInstruction(registers[PCReg])) == NULL)
+	return FALSE;			// exception occurred
 
-    if (DebugIsEnabled('m')) {
+    if (traceInstructions) {
        struct OpString *str = &opStrings[instr->opCode];
 
        ASSERT(instr->opCode <= MaxOpcode);
@@ -120,79 +200,113 @@ Machine::OneInstruction(Instruction *instr)
     unsigned int rs, rt, imm;
 
     // Execute the instruction (cf. Kane's book)
+#ifdef THREADED_DISPATCH
+    // Jump straight to the code for the opcode through a table of label
+    // addresses (a gcc extension), rather than through a switch.
+    // Opcode numbers with no case of their own go to OPDEFAULT.
+    static void *dispatch[MaxOpcode + 1] = {
+	&&op_default, &&op_OP_ADD, &&op_OP_ADDI, &&op_OP_ADDIU,
+	&&op_OP_ADDU, &&op_OP_AND, &&op_OP_ANDI, &&op_OP_BEQ,
+	&&op_OP_BGEZ, &&op_OP_BGEZAL, &&op_OP_BGTZ, &&op_OP_BLEZ,
+	&&op_OP_BLTZ, &&op_OP_BLTZAL, &&op_OP_BNE, &&op_default,
+	&&op_OP_DIV, &&op_OP_DIVU, &&op_OP_J, &&op_OP_JAL,
+	&&op_OP_JALR, &&op_OP_JR, &&op_OP_LB, &&op_OP_LBU,
+	&&op_OP_LH, &&op_OP_LHU, &&op_OP_LUI, &&op_OP_LW,
+	&&op_OP_LWL, &&op_OP_LWR, &&op_default, &&op_OP_MFHI,
+	&&op_OP_MFLO, &&op_default, &&op_OP_MTHI, &&op_OP_MTLO,
+	&&op_OP_MULT, &&op_OP_MULTU, &&op_OP_NOR, &&op_OP_OR,
+	&&op_OP_ORI, &&op_default, &&op_OP_SB, &&op_OP_SH,
+	&&op_OP_SLL, &&op_OP_SLLV, &&op_OP_SLT, &&op_OP_SLTI,
+	&&op_OP_SLTIU, &&op_OP_SLTU, &&op_OP_SRA, &&op_OP_SRAV,
+	&&op_OP_SRL, &&op_OP_SRLV, &&op_OP_SUB, &&op_OP_SUBU,
+	&&op_OP_SW, &&op_OP_SWL, &&op_OP_SWR, &&op_OP_XOR,
+	&&op_OP_XORI, &&op_OP_SYSCALL, &&op_OP_UNIMP, &&op_OP_RES
+    };
+#define OPCASE(op)	op_##op:
+#define OPDEFAULT	op_default:
+#define NEXT		goto executed
+
+    goto *dispatch[(int) instr->opCode];
+    {
+#else
+#define OPCASE(op)	case op:
+#define OPDEFAULT	default:
+#define NEXT		break
+
     switch (instr->opCode) {
+#endif
 	
-      case OP_ADD:
+      OPCASE(OP_ADD)
 	sum = registers[instr->rs] + registers[instr->rt];
 	if (!((registers[instr->rs] ^ registers[instr->rt]) & SIGN_BIT) &&
 	    ((registers[instr->rs] ^ sum) & SIGN_BIT)) {
 	    RaiseException(OverflowException, 0);
-	    return;
+	    return FALSE;
 	}
 	registers[instr->rd] = sum;
-	break;
+	NEXT;
 	
-      case OP_ADDI:
+      OPCASE(OP_ADDI)
 	sum = registers[instr->rs] + instr->extra;
 	if (!((registers[instr->rs] ^ instr->extra) & SIGN_BIT) &&
 	    ((instr->extra ^ sum) & SIGN_BIT)) {
 	    RaiseException(OverflowException, 0);
-	    return;
+	    return FALSE;
 	}
 	registers[instr->rt] = sum;
-	break;
+	NEXT;
 	
-      case OP_ADDIU:
+      OPCASE(OP_ADDIU)
 	registers[instr->rt] = registers[instr->rs] + instr->extra;
-	break;
+	NEXT;
 	
-      case OP_ADDU:
+      OPCASE(OP_ADDU)
 	registers[instr->rd] = registers[instr->rs] + registers[instr->rt];
-	break;
+	NEXT;
 	
-      case OP_AND:
+      OPCASE(OP_AND)
 	registers[instr->rd] = registers[instr->rs] & registers[instr->rt];
-	break;
+	NEXT;
 	
-      case OP_ANDI:
+      OPCASE(OP_ANDI)
 	registers[instr->rt] = registers[instr->rs] & (instr->extra & 0xffff);
-	break;
+	NEXT;
 	
-      case OP_BEQ:
+      OPCASE(OP_BEQ)
 	if (registers[instr->rs] == registers[instr->rt])
 	    pcAfter = registers[NextPCReg] + IndexToAddr(instr->extra);
-	break;
+	NEXT;
 	
-      case OP_BGEZAL:
+      OPCASE(OP_BGEZAL)
 	registers[R31] = registers[NextPCReg] + 4;
-      case OP_BGEZ:
+      OPCASE(OP_BGEZ)
 	if (!(registers[instr->rs] & SIGN_BIT))
 	    pcAfter = registers[NextPCReg] + IndexToAddr(instr->extra);
-	break;
+	NEXT;
 	
-      case OP_BGTZ:
+      OPCASE(OP_BGTZ)
 	if (registers[instr->rs] > 0)
 	    pcAfter = registers[NextPCReg] + IndexToAddr(instr->extra);
-	break;
+	NEXT;
 	
-      case OP_BLEZ:
+      OPCASE(OP_BLEZ)
 	if (registers[instr->rs] <= 0)
 	    pcAfter = registers[NextPCReg] + IndexToAddr(instr->extra);
-	break;
+	NEXT;
 	
-      case OP_BLTZAL:
+      OPCASE(OP_BLTZAL)
 	registers[R31] = registers[NextPCReg] + 4;
-      case OP_BLTZ:
+      OPCASE(OP_BLTZ)
 	if (registers[instr->rs] & SIGN_BIT)
 	    pcAfter = registers[NextPCReg] + IndexToAddr(instr->extra);
-	break;
+	NEXT;
 	
-      case OP_BNE:
+      OPCASE(OP_BNE)
 	if (registers[instr->rs] != registers[instr->rt])
 	    pcAfter = registers[NextPCReg] + IndexToAddr(instr->extra);
-	break;
+	NEXT;
 	
-      case OP_DIV:
+      OPCASE(OP_DIV)
 	if (registers[instr->rt] == 0) {
 	    registers[LoReg] = 0;
 	    registers[HiReg] = 0;
@@ -200,9 +314,9 @@ Machine::OneInstruction(Instruction *instr)
 	    registers[LoReg] =  registers[instr->rs] / registers[instr->rt];
 	    registers[HiReg] = registers[instr->rs] % registers[instr->rt];
 	}
-	break;
+	NEXT;
 	
-      case OP_DIVU:	  
+      OPCASE(OP_DIVU)
 	  rs = (unsigned int) registers[instr->rs];
 	  rt = (unsigned int) registers[instr->rt];
 	  if (rt == 0) {
@@ -214,25 +328,25 @@ Machine::OneInstruction(Instruction *instr)
 	      tmp = rs % rt;
 	      registers[HiReg] = (int) tmp;
 	  }
-	  break;
+	  NEXT;
 	
-      case OP_JAL:
+      OPCASE(OP_JAL)
 	registers[R31] = registers[NextPCReg] + 4;
-      case OP_J:
+      OPCASE(OP_J)
 	pcAfter = (pcAfter & 0xf0000000) | IndexToAddr(instr->extra);
-	break;
+	NEXT;
 	
-      case OP_JALR:
+      OPCASE(OP_JALR)
 	registers[instr->rd] = registers[NextPCReg] + 4;
-      case OP_JR:
+      OPCASE(OP_JR)
 	pcAfter = registers[instr->rs];
-	break;
+	NEXT;
 	
-      case OP_LB:
-      case OP_LBU:
+      OPCASE(OP_LB)
+      OPCASE(OP_LBU)
 	tmp = registers[instr->rs] + instr->extra;
 	if (!machine->ReadMem(tmp, 1, &value))
-	    return;
+	    return FALSE;
 
 	if ((value & 0x80) && (instr->opCode == OP_LB))
 	    value |= 0xffffff00;
@@ -240,17 +354,17 @@ Machine::OneInstruction(Instruction *instr)
 	    value &= 0xff;
 	nextLoadReg = instr->rt;
 	nextLoadValue = value;
-	break;
+	NEXT;
 	
-      case OP_LH:
-      case OP_LHU:	  
+      OPCASE(OP_LH)
+      OPCASE(OP_LHU)
 	tmp = registers[instr->rs] + instr->extra;
 	if (tmp & 0x1) {
 	    RaiseException(AddressErrorException, tmp);
-	    return;
+	    return FALSE;
 	}
 	if (!machine->ReadMem(tmp, 2, &value))
-	    return;
+	    return FALSE;
 
 	if ((value & 0x8000) && (instr->opCode == OP_LH))
 	    value |= 0xffff0000;
@@ -258,26 +372,25 @@ Machine::OneInstruction(Instruction *instr)
 	    value &= 0xffff;
 	nextLoadReg = instr->rt;
 	nextLoadValue = value;
-	break;
+	NEXT;
       	
-      case OP_LUI:
-	DEBUG('m', "Executing: LUI r%d,%d\n", instr->rt, instr->extra);
+      OPCASE(OP_LUI)
 	registers[instr->rt] = instr->extra << 16;
-	break;
+	NEXT;
 	
-      case OP_LW:
+      OPCASE(OP_LW)
 	tmp = registers[instr->rs] + instr->extra;
 	if (tmp & 0x3) {
 	    RaiseException(AddressErrorException, tmp);
-	    return;
+	    return FALSE;
 	}
 	if (!machine->ReadMem(tmp, 4, &value))
-	    return;
+	    return FALSE;
 	nextLoadReg = instr->rt;
 	nextLoadValue = value;
-	break;
+	NEXT;
     	
-      case OP_LWL:	  
+      OPCASE(OP_LWL)
 	tmp = registers[instr->rs] + instr->extra;
 
 	// ReadMem assumes all 4 byte requests are aligned on an even 
@@ -286,7 +399,7 @@ Machine::OneInstruction(Instruction *instr)
 	ASSERT((tmp & 0x3) == 0);  
 
 	if (!machine->ReadMem(tmp, 4, &value))
-	    return;
+	    return FALSE;
 	if (registers[LoadReg] == instr->rt)
 	    nextLoadValue = registers[LoadValueReg];
 	else
@@ -306,9 +419,9 @@ Machine::OneInstruction(Instruction *instr)
 	    break;
 	}
 	nextLoadReg = instr->rt;
-	break;
+	NEXT;
       	
-      case OP_LWR:
+      OPCASE(OP_LWR)
 	tmp = registers[instr->rs] + instr->extra;
 
 	// ReadMem assumes all 4 byte requests are aligned on an even 
@@ -317,7 +430,7 @@ Machine::OneInstruction(Instruction *instr)
 	ASSERT((tmp & 0x3) == 0);  
 
 	if (!machine->ReadMem(tmp, 4, &value))
-	    return;
+	    return FALSE;
 	if (registers[LoadReg] == instr->rt)
 	    nextLoadValue = registers[LoadValueReg];
 	else
@@ -340,141 +453,141 @@ Machine::OneInstruction(Instruction *instr)
 	    break;
 	}
 	nextLoadReg = instr->rt;
-	break;
+	NEXT;
     	
-      case OP_MFHI:
+      OPCASE(OP_MFHI)
 	registers[instr->rd] = registers[HiReg];
-	break;
+	NEXT;
 	
-      case OP_MFLO:
+      OPCASE(OP_MFLO)
 	registers[instr->rd] = registers[LoReg];
-	break;
+	NEXT;
 	
-      case OP_MTHI:
+      OPCASE(OP_MTHI)
 	registers[HiReg] = registers[instr->rs];
-	break;
+	NEXT;
 	
-      case OP_MTLO:
+      OPCASE(OP_MTLO)
 	registers[LoReg] = registers[instr->rs];
-	break;
+	NEXT;
 	
-      case OP_MULT:
+      OPCASE(OP_MULT)
 	Mult(registers[instr->rs], registers[instr->rt], TRUE,
 	     &registers[HiReg], &registers[LoReg]);
-	break;
+	NEXT;
 	
-      case OP_MULTU:
+      OPCASE(OP_MULTU)
 	Mult(registers[instr->rs], registers[instr->rt], FALSE,
 	     &registers[HiReg], &registers[LoReg]);
-	break;
+	NEXT;
 	
-      case OP_NOR:
+      OPCASE(OP_NOR)
 	registers[instr->rd] = ~(registers[instr->rs] | registers[instr->rt]);
-	break;
+	NEXT;
 	
-      case OP_OR:
+      OPCASE(OP_OR)
 	registers[instr->rd] = registers[instr->rs] | registers[instr->rs];
-	break;
+	NEXT;
 	
-      case OP_ORI:
+      OPCASE(OP_ORI)
 	registers[instr->rt] = registers[instr->rs] | (instr->extra & 0xffff);
-	break;
+	NEXT;
 	
-      case OP_SB:
+      OPCASE(OP_SB)
 	if (!machine->WriteMem((unsigned) 
 		(registers[instr->rs] + instr->extra), 1, registers[instr->rt]))
-	    return;
-	break;
+	    return FALSE;
+	NEXT;
 	
-      case OP_SH:
+      OPCASE(OP_SH)
 	if (!machine->WriteMem((unsigned) 
 		(registers[instr->rs] + instr->extra), 2, registers[instr->rt]))
-	    return;
-	break;
+	    return FALSE;
+	NEXT;
 	
-      case OP_SLL:
+      OPCASE(OP_SLL)
 	registers[instr->rd] = registers[instr->rt] << instr->extra;
-	break;
+	NEXT;
 	
-      case OP_SLLV:
+      OPCASE(OP_SLLV)
 	registers[instr->rd] = registers[instr->rt] <<
 	    (registers[instr->rs] & 0x1f);
-	break;
+	NEXT;
 	
-      case OP_SLT:
+      OPCASE(OP_SLT)
 	if (registers[instr->rs] < registers[instr->rt])
 	    registers[instr->rd] = 1;
 	else
 	    registers[instr->rd] = 0;
-	break;
+	NEXT;
 	
-      case OP_SLTI:
+      OPCASE(OP_SLTI)
 	if (registers[instr->rs] < instr->extra)
 	    registers[instr->rt] = 1;
 	else
 	    registers[instr->rt] = 0;
-	break;
+	NEXT;
 	
-      case OP_SLTIU:	  
+      OPCASE(OP_SLTIU)
 	rs = registers[instr->rs];
 	imm = instr->extra;
 	if (rs < imm)
 	    registers[instr->rt] = 1;
 	else
 	    registers[instr->rt] = 0;
-	break;
+	NEXT;
       	
-      case OP_SLTU:	  
+      OPCASE(OP_SLTU)
 	rs = registers[instr->rs];
 	rt = registers[instr->rt];
 	if (rs < rt)
 	    registers[instr->rd] = 1;
 	else
 	    registers[instr->rd] = 0;
-	break;
+	NEXT;
       	
-      case OP_SRA:
+      OPCASE(OP_SRA)
 	registers[instr->rd] = registers[instr->rt] >> instr->extra;
-	break;
+	NEXT;
 	
-      case OP_SRAV:
+      OPCASE(OP_SRAV)
 	registers[instr->rd] = registers[instr->rt] >>
 	    (registers[instr->rs] & 0x1f);
-	break;
+	NEXT;
 	
-      case OP_SRL:
+      OPCASE(OP_SRL)
 	tmp = registers[instr->rt];
 	tmp >>= instr->extra;
 	registers[instr->rd] = tmp;
-	break;
+	NEXT;
 	
-      case OP_SRLV:
+      OPCASE(OP_SRLV)
 	tmp = registers[instr->rt];
 	tmp >>= (registers[instr->rs] & 0x1f);
 	registers[instr->rd] = tmp;
-	break;
+	NEXT;
 	
-      case OP_SUB:	  
+      OPCASE(OP_SUB)
 	diff = registers[instr->rs] - registers[instr->rt];
 	if (((registers[instr->rs] ^ registers[instr->rt]) & SIGN_BIT) &&
 	    ((registers[instr->rs] ^ diff) & SIGN_BIT)) {
 	    RaiseException(OverflowException, 0);
-	    return;
+	    return FALSE;
 	}
 	registers[instr->rd] = diff;
-	break;
+	NEXT;
       	
-      case OP_SUBU:
+      OPCASE(OP_SUBU)
 	registers[instr->rd] = registers[instr->rs] - registers[instr->rt];
-	break;
+	NEXT;
 	
-      case OP_SW:
+      OPCASE(OP_SW)
 	if (!machine->WriteMem((unsigned) 
 		(registers[instr->rs] + instr->extra), 4, registers[instr->rt]))
-	    return;
-	break;
+	    return FALSE;
+	NEXT;
 	
-      case OP_SWL:	  
+      OPCASE(OP_SWL)
 	tmp = registers[instr->rs] + instr->extra;
 
 	// The little endian/big endian swap code would
@@ -482,7 +595,7 @@ Machine::OneInstruction(Instruction *instr)
 	ASSERT((tmp & 0x3) == 0);  
 
 	if (!machine->ReadMem((tmp & ~0x3), 4, &value))
-	    return;
+	    return FALSE;
 	switch (tmp & 0x3) {
 	  case 0:
 	    value = registers[instr->rt];
@@ -501,10 +614,10 @@ Machine::OneInstruction(Instruction *instr)
 	    break;
 	}
 	if (!machine->WriteMem((tmp & ~0x3), 4, value))
-	    return;
-	break;
+	    return FALSE;
+	NEXT;
     	
-      case OP_SWR:	  
+      OPCASE(OP_SWR)
 	tmp = registers[instr->rs] + instr->extra;
 
 	// The little endian/big endian swap code would
@@ -512,7 +625,7 @@ Machine::OneInstruction(Instruction *instr)
 	ASSERT((tmp & 0x3) == 0);  
 
 	if (!machine->ReadMem((tmp & ~0x3), 4, &value))
-	    return;
+	    return FALSE;
 	switch (tmp & 0x3) {
 	  case 0:
 	    value = (value & 0xffffff) | (registers[instr->rt] << 24);
@@ -528,32 +641,41 @@ Machine::OneInstruction(Instruction *instr)
 	    break;
 	} // end of switch (tmp & 0x3) 
 	if (!machine->WriteMem((tmp & ~0x3), 4, value))
-	    return;
-	break;
+	    return FALSE;
+	NEXT;
     	
-      case OP_SYSCALL:
+      OPCASE(OP_SYSCALL)
 	RaiseException(SyscallException, 0);
-	return; 
+	return FALSE; 
 	
-      case OP_XOR:
+      OPCASE(OP_XOR)
 	registers[instr->rd] = registers[instr->rs] ^ registers[instr->rt];
-	break;
+	NEXT;
 	
-      case OP_XORI:
+      OPCASE(OP_XORI)
 	registers[instr->rt] = registers[instr->rs] ^ (instr->extra & 0xffff);
-	break;
+	NEXT;
 	
-      case OP_RES:
-      case OP_UNIMP:
+      OPCASE(OP_RES)
+      OPCASE(OP_UNIMP)
 	RaiseException(IllegalInstrException, 0);
-	return;
+	return FALSE;
 	
-      default:
+      OPDEFAULT
 	ASSERT(FALSE);
     }
+#ifdef THREADED_DISPATCH
+  executed:
+#endif
+#undef OPCASE
+#undef OPDEFAULT
+#undef NEXT
     
     // Now we have successfully executed the instruction.
     
+    if (profiling)
+	ProfileInstruction(instr, pcAfter != registers[NextPCReg] + 4);
+
     // Do any delayed load operation
     DelayedLoad(nextLoadReg, nextLoadValue);
     
@@ -562,6 +684,203 @@ Machine::OneInstruction(Instruction *instr)
 						// are jumping into lala-land
     registers[PCReg] = registers[NextPCReg];
     registers[NextPCReg] = pcAfter;
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// Machine::StartProfile
+// 	Start counting the user instructions executed, per virtual PC and
+//	per opcode.  The counts are printed by PrintProfile when Nachos
+//	halts.  Counts for all address spaces are added together.
+//----------------------------------------------------------------------
+
+void
+Machine::StartProfile()
+{
+    if (profiling)
+	return;
+    profiling = TRUE;
+    pcProfileSize = MemorySize / 4;	// grown as needed
+    pcProfile = new ProfileCount[pcProfileSize];
+    bzero(pcProfile, pcProfileSize * sizeof(ProfileCount));
+    opProfile = new ProfileCount[MaxOpcode + 1];
+    bzero(opProfile, (MaxOpcode + 1) * sizeof(ProfileCount));
+}
+
+//----------------------------------------------------------------------
+// Machine::ProfileInstruction
+// 	Count an instruction that has just completed at registers[PCReg].
+//	Called from OneInstruction before the PC is advanced.
+//
+//	"instr" -- the instruction executed
+//	"taken" -- TRUE if it was a branch or jump, and control transferred
+//----------------------------------------------------------------------
+
+void
+Machine::ProfileInstruction(Instruction *instr, bool taken)
+{
+    unsigned int word = (unsigned) registers[PCReg] / 4;
+    ProfileCount *count;
+
+    if (word >= pcProfileSize) {
+	unsigned int size = pcProfileSize;
+	ProfileCount *bigger;
+
+	while (size <= word)
+	    size *= 2;
+	bigger = new ProfileCount[size];
+	bzero(bigger, size * sizeof(ProfileCount));
+	bcopy(pcProfile, bigger, pcProfileSize * sizeof(ProfileCount));
+	delete [] pcProfile;
+	pcProfile = bigger;
+	pcProfileSize = size;
+    }
+    count = &pcProfile[word];
+    count->executed++;
+    count->value = instr->value;
+    opProfile[instr->opCode].executed++;
+    if (taken) {
+	count->taken++;
+	opProfile[instr->opCode].taken++;
+    }
+}
+
+//----------------------------------------------------------------------
+// PrintInstruction
+// 	Print the instruction word "value" the way the 'm' trace does.
+//----------------------------------------------------------------------
+
+static void
+PrintInstruction(unsigned int value)
+{
+    Instruction instr;
+    struct OpString *str;
+
+    instr.value = value;
+    instr.Decode();
+    str = &opStrings[instr.opCode];
+    printf(str->string, TypeToReg(str->args[0], &instr), 
+	    TypeToReg(str->args[1], &instr), TypeToReg(str->args[2], &instr));
+}
+
+//----------------------------------------------------------------------
+// Machine::PrintProfile
+// 	Print the counts gathered since StartProfile: the mix of opcodes,
+//	loads and stores, how often each kind of branch was taken, and the
+//	most executed PCs with the instruction found there.  Only
+//	instructions that completed are counted, so a syscall, or an
+//	instruction that faulted, is not.
+//----------------------------------------------------------------------
+
+void
+Machine::PrintProfile()
+{
+    double total = 0, loads = 0, stores = 0;
+    int op;
+    unsigned int i, j;
+
+    if (!profiling)
+	return;
+    for (op = 0; op <= MaxOpcode; op++) {
+	total += opProfile[op].executed;
+	if ((op >= OP_LB && op <= OP_LW && op != OP_LUI) || 
+				op == OP_LWL || op == OP_LWR)
+	    loads += opProfile[op].executed;
+	else if (op == OP_SB || op == OP_SH || op == OP_SW || 
+				op == OP_SWL || op == OP_SWR)
+	    stores += opProfile[op].executed;
+    }
+    if (total == 0)
+	return;
+    printf("\nProfile: %.0f instructions, %.0f loads (%.1f%%), "
+	"%.0f stores (%.1f%%)\n", total, loads, 100 * loads / total,
+	stores, 100 * stores / total);
+
+    printf("Opcode\t\tcount\t%%\ttaken\n");
+    for (op = 0; op <= MaxOpcode; op++) {
+	if (opProfile[op].executed == 0)
+	    continue;
+	printf("%-12.*s\t%u\t%.1f", (int) strcspn(opStrings[op].string, " "),
+	    opStrings[op].string, opProfile[op].executed,
+	    100.0 * opProfile[op].executed / total);
+	if ((op >= OP_BEQ && op <= OP_BNE) || (op >= OP_J && op <= OP_JR))
+	    printf("\t%.1f%%", 100.0 * opProfile[op].taken / 
+						opProfile[op].executed);
+	printf("\n");
+    }
+
+    // Keep the hottest PCs seen so far in "hot", most executed first.
+    ProfileCount *hot[ProfileHotPCs];
+    int numHot = 0;
+
+    for (i = 0; i < pcProfileSize; i++) {
+	ProfileCount *count = &pcProfile[i];
+
+	if (count->executed == 0)
+	    continue;
+	if (numHot == ProfileHotPCs && 
+			count->executed <= hot[numHot - 1]->executed)
+	    continue;
+	if (numHot < ProfileHotPCs)
+	    numHot++;
+	for (j = numHot - 1; j > 0 && 
+			hot[j - 1]->executed < count->executed; j--)
+	    hot[j] = hot[j - 1];
+	hot[j] = count;
+    }
+    printf("PC\t\tcount\t%%\ttaken\tinstruction\n");
+    for (j = 0; j < (unsigned) numHot; j++) {
+	printf("0x%-8x\t%u\t%.1f\t%u\t", (unsigned) (hot[j] - pcProfile) * 4,
+	    hot[j]->executed, 100.0 * hot[j]->executed / total, hot[j]->taken);
+	PrintInstruction(hot[j]->value);
+	printf("\n");
+    }
+}
+
+//----------------------------------------------------------------------
+// Machine::FetchInstruction
+// 	Translate "virtAddr" for an instruction fetch and return the
+//	decoded instruction stored there.  Returns NULL if the translation
+//	failed, in which case the exception has already been raised.
+//
+//	Decoded instructions are cached per physical word of mainMemory,
+//	so a loop only pays for Decode the first time through.  Each entry
+//	remembers the raw word it was decoded from and is re-decoded
+//	whenever memory holds something else.  That keeps the cache
+//	coherent with everything that changes mainMemory -- WriteMem, the
+//	kernel loading a program, a frame being handed to another address
+//	space -- without having to invalidate it explicitly, and since it
+//	is indexed by physical address, page table changes don't affect it.
+//
+//	"virtAddr" -- the program counter to fetch from
+//----------------------------------------------------------------------
+
+Instruction *
+Machine::FetchInstruction(int virtAddr)
+{
+    ExceptionType exception;
+    int physAddr;
+    char *location;
+    unsigned int raw;
+    Instruction *instr;
+
+    location = CachedTranslate(virtAddr, 4, FALSE);
+    if (location != NULL)
+	physAddr = location - mainMemory;
+    else {
+	exception = Translate(virtAddr, &physAddr, 4, FALSE);
+	if (exception != NoException) {
+	    RaiseException(exception, virtAddr);
+	    return NULL;
+	}
+    }
+    raw = WordToHost(*(unsigned int *) &mainMemory[physAddr]);
+    instr = &decodeCache[physAddr / 4];
+    if (instr->value != raw) {		// stale, or not decoded yet
+	instr->value = raw;
+	instr->Decode();
+    }
+    return instr;
 }
 
 //----------------------------------------------------------------------
@@ -96,6 +96,11 @@
 #define SIGN_BIT	0x80000000
 #define R31		31
 
+#define MaxBlockSize	64	// longest straight-line run Machine::RunBlock
+				// executes before checking for interrupts
+#define ProfileHotPCs	20	// how many of the most executed PCs
+				// Machine::PrintProfile lists
+
 /*
  * The table below is used to translate bits 31:26 of the instruction
  * into a value suitable for the "opCode" field of a MemWord structure,
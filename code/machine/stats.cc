@@ -22,12 +22,20 @@ Statistics::Statistics()
     numDiskReads = numDiskWrites = 0;
     numConsoleCharsRead = numConsoleCharsWritten = 0;
     numPageFaults = numPacketsSent = numPacketsRecvd = 0;
+    numTLBHits = numTLBMisses = 0;
+    numPageEvictions = numPageOuts = numPageCopies = 0;
+    numZeroFills = numIdleZeroFills = 0;
+    numCacheHits = numCacheMisses = numWriteBehinds = numReadAheads = 0;
+    diskSeekTracks = diskWaitTicks = 0;
+    hostStartTime = HostTime();
 }
 
 //----------------------------------------------------------------------
 // Statistics::Print
 // 	Print performance metrics, when we've finished everything
-//	at system shutdown.
+//	at system shutdown.  The disk cache, paging and TLB lines are only
+//	printed if their counters moved, so kernels without those features
+//	print what they always did.
 //----------------------------------------------------------------------
 
 void
@@ -36,9 +44,33 @@ Statistics::Print()
     printf("Ticks: total %d, idle %d, system %d, user %d\n", totalTicks, 
 	idleTicks, systemTicks, userTicks);
     printf("Disk I/O: reads %d, writes %d\n", numDiskReads, numDiskWrites);
+    if (numCacheHits + numCacheMisses > 0)
+	printf("Disk cache: hits %d, misses %d, read ahead %d, "
+	    "written while idle %d\n", numCacheHits, numCacheMisses,
+	    numReadAheads, numWriteBehinds);
+    if (diskWaitTicks > 0)
+	printf("Disk scheduling: average seek %.2f tracks, average response "
+	    "%.2f ticks\n", (double) diskSeekTracks / (numDiskReads +
+	    numDiskWrites), (double) diskWaitTicks / (numDiskReads +
+	    numDiskWrites));
     printf("Console I/O: reads %d, writes %d\n", numConsoleCharsRead, 
 	numConsoleCharsWritten);
-    printf("Paging: faults %d\n", numPageFaults);
+    if (numPageFaults + numPageCopies > 0)
+	printf("Paging: faults %d, evictions %d, writes to swap %d, "
+	    "copy-on-write copies %d\n", numPageFaults, numPageEvictions,
+	    numPageOuts, numPageCopies);
+    if (numZeroFills + numIdleZeroFills > 0)
+	printf("Zero fill: %d pages on demand, %d frames while idle\n",
+	    numZeroFills, numIdleZeroFills);
+    if (numTLBHits + numTLBMisses > 0)
+	printf("TLB: hits %d, misses %d (%.2f%% miss rate)\n", numTLBHits,
+	    numTLBMisses, 100.0 * numTLBMisses / (numTLBHits + numTLBMisses));
     printf("Network I/O: packets received %d, sent %d\n", numPacketsRecvd, 
 	numPacketsSent);
+    if (userTicks > 0) {
+	double elapsed = HostTime() - hostStartTime;
+
+	printf("Host: %.2f seconds, %.0f user instructions/sec\n", elapsed,
+	    (elapsed > 0) ? (userTicks / UserTick) / elapsed : 0.0);
+    }
 }
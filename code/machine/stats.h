@@ -33,9 +33,26 @@ class Statistics {
     int numConsoleCharsRead;	// number of characters read from the keyboard
     int numConsoleCharsWritten; // number of characters written to the display
     int numPageFaults;		// number of virtual memory page faults
+    int numPageEvictions;	// number of pages evicted from memory
+    int numPageOuts;		// number of those written to swap
+    int numPageCopies;		// number of copy-on-write pages copied
+    int numZeroFills;		// number of pages zeroed on a page fault
+    int numIdleZeroFills;	// number of free frames zeroed while idle
+    int numCacheHits;		// number of sectors found in the disk cache
+    int numCacheMisses;		// number that had to be read from disk
+    int numWriteBehinds;	// number of dirty sectors written while idle
+    int numReadAheads;		// number of sectors read ahead
+    int diskSeekTracks;		// tracks the disk head has moved
+    int diskWaitTicks;		// time disk requests took, from being
+				// queued to being done, summed
+    int numTLBHits;		// number of translations found in the TLB
+    int numTLBMisses;		// number of TLB misses (exceptions)
     int numPacketsSent;		// number of packets sent over the network
     int numPacketsRecvd;	// number of packets received over the network
 
+    double hostStartTime;	// host wall clock time at startup, to
+				// report simulation speed
+
     Statistics(); 		// initialize everything to zero
 
     void Print();		// print collected statistics
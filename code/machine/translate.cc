@@ -90,27 +90,32 @@ Machine::ReadMem(int addr, int size, int *value)
     int data;
     ExceptionType exception;
     int physicalAddress;
+    char *location;
     
-    DEBUG('a', "Reading VA 0x%x, size %d\n", addr, size);
+    location = CachedTranslate(addr, size, FALSE);
+    if (location == NULL) {
+	DEBUG('a', "Reading VA 0x%x, size %d\n", addr, size);
     
-    exception = Translate(addr, &physicalAddress, size, FALSE);
-    if (exception != NoException) {
-	machine->RaiseException(exception, addr);
-	return FALSE;
+	exception = Translate(addr, &physicalAddress, size, FALSE);
+	if (exception != NoException) {
+	    machine->RaiseException(exception, addr);
+	    return FALSE;
+	}
+	location = &mainMemory[physicalAddress];
     }
     switch (size) {
       case 1:
-	data = machine->mainMemory[physicalAddress];
+	data = *location;
 	*value = data;
 	break;
 	
       case 2:
-	data = *(unsigned short *) &machine->mainMemory[physicalAddress];
+	data = *(unsigned short *) location;
 	*value = ShortToHost(data);
 	break;
 	
       case 4:
-	data = *(unsigned int *) &machine->mainMemory[physicalAddress];
+	data = *(unsigned int *) location;
 	*value = WordToHost(data);
 	break;
 
@@ -139,26 +144,31 @@ Machine::WriteMem(int addr, int size, int value)
 {
     ExceptionType exception;
     int physicalAddress;
+    char *location;
      
-    DEBUG('a', "Writing VA 0x%x, size %d, value 0x%x\n", addr, size, value);
+    location = CachedTranslate(addr, size, TRUE);
+    if (location == NULL) {
+	DEBUG('a', "Writing VA 0x%x, size %d, value 0x%x\n", addr, size, value);
 
-    exception = Translate(addr, &physicalAddress, size, TRUE);
-    if (exception != NoException) {
-	machine->RaiseException(exception, addr);
-	return FALSE;
+	exception = Translate(addr, &physicalAddress, size, TRUE);
+	if (exception != NoException) {
+	    machine->RaiseException(exception, addr);
+	    return FALSE;
+	}
+	location = &mainMemory[physicalAddress];
     }
     switch (size) {
       case 1:
-	machine->mainMemory[physicalAddress] = (unsigned char) (value & 0xff);
+	*location = (unsigned char) (value & 0xff);
 	break;
 
       case 2:
-	*(unsigned short *) &machine->mainMemory[physicalAddress]
+	*(unsigned short *) location
 		= ShortToMachine((unsigned short) (value & 0xffff));
 	break;
       
       case 4:
-	*(unsigned int *) &machine->mainMemory[physicalAddress]
+	*(unsigned int *) location
 		= WordToMachine((unsigned int) value);
 	break;
 	
@@ -168,6 +178,178 @@ Machine::WriteMem(int addr, int size, int value)
     return TRUE;
 }
 
+//----------------------------------------------------------------------
+// Machine::TranslateSpan
+// 	Translate "virtAddr" for a bulk copy, and return where it is in
+//	mainMemory.  "spanBytes" is set to the number of bytes from there
+//	to the end of the page, all of which may be copied at once.
+//
+//	A page fault, or a write to a read-only page, is raised as an
+//	exception, just as ReadMem and WriteMem do; but since the caller
+//	is the kernel and not an instruction that can be restarted, the
+//	translation is retried once the exception handler has dealt with
+//	it -- brought the page in, or given the address space its own
+//	copy of a copy-on-write page.  Returns NULL, after raising the
+//	exception, if any other error occurs.
+//
+//	"virtAddr" -- the virtual address to translate
+// 	"writing" -- if TRUE, the page is about to be written
+//	"spanBytes" -- the place to store the length of the span
+//----------------------------------------------------------------------
+
+char *
+Machine::TranslateSpan(int virtAddr, bool writing, int *spanBytes)
+{
+    ExceptionType exception;
+    int physicalAddress;
+    char *location;
+
+    location = CachedTranslate(virtAddr, 1, writing);
+    if (location == NULL) {
+	while ((exception = Translate(virtAddr, &physicalAddress, 1, writing))
+							!= NoException) {
+	    RaiseException(exception, virtAddr);
+	    if (exception != PageFaultException
+				&& exception != ReadOnlyException)
+		return NULL;
+	}
+	location = &mainMemory[physicalAddress];
+    }
+    *spanBytes = PageSize - (unsigned) virtAddr % PageSize;
+    return location;
+}
+
+//----------------------------------------------------------------------
+// Machine::CopyFromUser
+// 	Copy "numBytes" bytes of the running program's virtual memory,
+//	starting at "virtAddr", into the kernel buffer "into".  Each page
+//	is translated once and copied as a whole, instead of translating
+//	every byte with ReadMem.
+//
+//   	Returns FALSE if some page couldn't be translated; "into" may
+//	then have been partly filled.
+//----------------------------------------------------------------------
+
+bool
+Machine::CopyFromUser(int virtAddr, char *into, int numBytes)
+{
+    char *location;
+    int span;
+
+    DEBUG('a', "Copying %d bytes from VA 0x%x\n", numBytes, virtAddr);
+    while (numBytes > 0) {
+	location = TranslateSpan(virtAddr, FALSE, &span);
+	if (location == NULL)
+	    return FALSE;
+	if (span > numBytes)
+	    span = numBytes;
+	bcopy(location, into, span);
+	virtAddr += span;
+	into += span;
+	numBytes -= span;
+    }
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// Machine::CopyToUser
+// 	Copy "numBytes" bytes from the kernel buffer "from" into the
+//	running program's virtual memory, starting at "virtAddr", a page
+//	at a time.
+//
+//   	Returns FALSE if some page couldn't be translated, or is
+//	read-only; the pages before it have already been written.
+//----------------------------------------------------------------------
+
+bool
+Machine::CopyToUser(int virtAddr, char *from, int numBytes)
+{
+    char *location;
+    int span;
+
+    DEBUG('a', "Copying %d bytes to VA 0x%x\n", numBytes, virtAddr);
+    while (numBytes > 0) {
+	location = TranslateSpan(virtAddr, TRUE, &span);
+	if (location == NULL)
+	    return FALSE;
+	if (span > numBytes)
+	    span = numBytes;
+	bcopy(from, location, span);
+	virtAddr += span;
+	from += span;
+	numBytes -= span;
+    }
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// Machine::CopyStringFromUser
+// 	Copy a null-terminated string out of the running program's virtual
+//	memory into "into", which has room for "maxBytes" bytes including
+//	the terminating null.  Pages are searched for the null and copied
+//	a span at a time.
+//
+//   	Returns the length of the string, or -1 if a page couldn't be
+//	translated or the string didn't fit.  Either way "into" is left
+//	null-terminated.
+//----------------------------------------------------------------------
+
+int
+Machine::CopyStringFromUser(int virtAddr, char *into, int maxBytes)
+{
+    char *location, *end;
+    int span, length = 0;
+
+    ASSERT(maxBytes > 0);
+    while (length < maxBytes) {
+	location = TranslateSpan(virtAddr + length, FALSE, &span);
+	if (location == NULL)
+	    break;
+	if (span > maxBytes - length)
+	    span = maxBytes - length;
+	end = (char *) memchr(location, '\0', span);
+	if (end != NULL) {
+	    bcopy(location, into + length, end - location + 1);
+	    return length + (end - location);
+	}
+	bcopy(location, into + length, span);
+	length += span;
+    }
+    into[length < maxBytes ? length : maxBytes - 1] = '\0';
+    return -1;
+}
+
+//----------------------------------------------------------------------
+// Machine::CachedTranslate
+// 	Translate a virtual address using only the host TLB, the
+//	simulator's cache of recent page table translations.  Returns
+//	a pointer to the byte in mainMemory, or NULL if the page isn't
+//	cached, the access is misaligned, or it is a write to a read-only
+//	page -- in which case the caller must go through Translate, which
+//	reports the exception (if any) and refills the cache.
+//
+//	Sets the use and dirty bits exactly as Translate would.  Only
+//	page table translations are cached; with a software-loaded TLB
+//	every reference still goes through Translate.
+//----------------------------------------------------------------------
+
+char *
+Machine::CachedTranslate(int virtAddr, int size, bool writing)
+{
+    unsigned int vpn = (unsigned) virtAddr / PageSize;
+    HostTLBEntry *cached = &hostTLB[vpn % HostTLBSize];
+
+    if (cached->virtualPage != vpn || (virtAddr & (size - 1)))
+	return NULL;
+    if (writing) {
+	if (!cached->writable)
+	    return NULL;
+	cached->entry->dirty = TRUE;
+    }
+    cached->entry->use = TRUE;
+    return cached->page + (unsigned) virtAddr % PageSize;
+}
+
 //----------------------------------------------------------------------
 // Machine::Translate
 // 	Translate a virtual address into a physical address, using 
@@ -186,7 +368,7 @@ Machine::WriteMem(int addr, int size, int value)
 ExceptionType
 Machine::Translate(int virtAddr, int* physAddr, int size, bool writing)
 {
-    int i;
+    int i, which;
     unsigned int vpn, offset;
     TranslationEntry *entry;
     unsigned int pageFrame;
@@ -220,17 +402,32 @@ Machine::Translate(int virtAddr, int* physAddr, int size, bool writing)
 	}
 	entry = &pageTable[vpn];
     } else {
-        for (entry = NULL, i = 0; i < TLBSize; i++)
-    	    if (tlb[i].valid && ((unsigned int)tlb[i].virtualPage == vpn)) {
-		entry = &tlb[i];			// FOUND!
-		break;
-	    }
+	// Look for an entry mapping the page itself, and then for one
+	// mapping each size of superpage that could contain it.  An entry
+	// is in the set of the first page it maps, counted in its size.
+	for (entry = NULL, which = 0; entry == NULL && which < numPageSizes;
+								which++) {
+	    int pages = pageSizes[which];
+	    unsigned int firstPage = vpn - vpn % pages;
+	    int first = ((firstPage / pages) % (tlbSize / tlbWays)) * tlbWays;
+
+	    for (i = first; i < first + tlbWays; i++)
+		if (tlb[i].valid && tlb[i].superPages == pages
+			&& ((unsigned int)tlb[i].virtualPage == firstPage)) {
+		    entry = &tlb[i];			// FOUND!
+		    break;
+		}
+	}
 	if (entry == NULL) {				// not found
     	    DEBUG('a', "*** no valid TLB entry found for this virtual page!\n");
+	    stats->numTLBMisses++;
     	    return PageFaultException;		// really, this is a TLB fault,
 						// the page may be in memory,
 						// but not in the TLB
 	}
+	stats->numTLBHits++;
+	tlbSlots[i].useTime = ++tlbTime;
+	tlbSlots[i].referenced = TRUE;
     }
 
     if (entry->readOnly && writing) {	// trying to write to a read-only page
@@ -238,10 +435,12 @@ Machine::Translate(int virtAddr, int* physAddr, int size, bool writing)
 	return ReadOnlyException;
     }
     pageFrame = entry->physicalPage;
+    if (tlb != NULL)			// the entry may map a superpage
+	pageFrame += vpn - entry->virtualPage;
 
     // if the pageFrame is too big, there is something really wrong! 
     // An invalid translation was loaded into the page table or TLB. 
-    if (pageFrame >= NumPhysPages) { 
+    if (pageFrame >= (unsigned) NumPhysPages) { 
 	DEBUG('a', "*** frame %d > %d!\n", pageFrame, NumPhysPages);
 	return BusErrorException;
     }
@@ -250,6 +449,110 @@ Machine::Translate(int virtAddr, int* physAddr, int size, bool writing)
 	entry->dirty = TRUE;
     *physAddr = pageFrame * PageSize + offset;
     ASSERT((*physAddr >= 0) && ((*physAddr + size) <= MemorySize));
+    if (tlb == NULL) {		// remember the translation for next time
+	HostTLBEntry *cached = &hostTLB[vpn % HostTLBSize];
+
+	cached->virtualPage = vpn;
+	cached->entry = entry;
+	cached->page = &mainMemory[pageFrame * PageSize];
+	cached->writable = !entry->readOnly;
+    }
     DEBUG('a', "phys addr = 0x%x\n", *physAddr);
     return NoException;
 }
+
+//----------------------------------------------------------------------
+// Machine::LoadTLB
+// 	Called by the kernel on a TLB miss, to load a copy of the page
+//	table entry "entry" into the TLB.  If the set the page maps to has
+//	no invalid entry, one is replaced according to the policy chosen
+//	with ConfigureTLB; its use and dirty bits are copied back to the
+//	page table entry it came from.
+//
+//	"entry" -- the page table entry to load; it must stay allocated
+//		until the TLB is flushed
+//----------------------------------------------------------------------
+
+void
+Machine::LoadTLB(TranslationEntry *entry)
+{
+    int set = (entry->virtualPage / entry->superPages) % (tlbSize / tlbWays);
+    int first = set * tlbWays;
+    int i, victim = -1;
+
+    ASSERT(tlb != NULL);
+    ASSERT(entry->virtualPage % entry->superPages == 0);
+    for (i = first; i < first + tlbWays; i++)
+	if (!tlb[i].valid) {
+	    victim = i;
+	    break;
+	}
+    if (victim < 0) {
+	switch (tlbPolicy) {
+	  case TLBFifo:
+	  case TLBLru:
+	    victim = first;
+	    for (i = first + 1; i < first + tlbWays; i++)
+		if (tlbPolicy == TLBFifo ?
+			(tlbSlots[i].loadTime < tlbSlots[victim].loadTime) :
+			(tlbSlots[i].useTime < tlbSlots[victim].useTime))
+		    victim = i;
+	    break;
+
+	  case TLBClock:
+	    while (tlbSlots[first + tlbHands[set]].referenced) {
+		tlbSlots[first + tlbHands[set]].referenced = FALSE;
+		tlbHands[set] = (tlbHands[set] + 1) % tlbWays;
+	    }
+	    victim = first + tlbHands[set];
+	    tlbHands[set] = (tlbHands[set] + 1) % tlbWays;
+	    break;
+	}
+	EvictTLBEntry(victim);
+    }
+    DEBUG('a', "Loading virtual page %d (%d pages) into TLB entry %d\n",
+				entry->virtualPage, entry->superPages, victim);
+    tlb[victim] = *entry;
+    tlbSlots[victim].backing = entry;
+    tlbSlots[victim].loadTime = tlbSlots[victim].useTime = ++tlbTime;
+    tlbSlots[victim].referenced = TRUE;
+}
+
+//----------------------------------------------------------------------
+// Machine::FlushTLB
+// 	Invalidate every TLB entry, copying its use and dirty bits back to
+//	the page table.  Must be called before switching to another address
+//	space, and before the current page table is changed or deleted.
+//----------------------------------------------------------------------
+
+void
+Machine::FlushTLB()
+{
+    for (int i = 0; i < tlbSize; i++)
+	if (tlb[i].valid)
+	    EvictTLBEntry(i);
+}
+
+//----------------------------------------------------------------------
+// Machine::EvictTLBEntry
+// 	Invalidate one TLB entry, first copying back the use and dirty bits
+//	set by Translate to the page table entry it was loaded from.  For
+//	a superpage, they are copied to the entries of all its pages,
+//	which follow that one in the page table.
+//----------------------------------------------------------------------
+
+void
+Machine::EvictTLBEntry(int which)
+{
+    TranslationEntry *backing = tlbSlots[which].backing;
+
+    if (backing != NULL)
+	for (int i = 0; i < tlb[which].superPages; i++) {
+	    if (tlb[which].use)
+		backing[i].use = TRUE;
+	    if (tlb[which].dirty)
+		backing[i].dirty = TRUE;
+	}
+    tlb[which].valid = FALSE;
+    tlbSlots[which].backing = NULL;
+}
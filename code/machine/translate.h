@@ -26,9 +26,17 @@
 // virtual page to one physical page.
 // In addition, there are some extra bits for access control (valid and 
 // read-only) and some bits for usage information (use and dirty).
+//
+// A TLB entry can also map a superpage: "superPages" pages, a power of
+// two, starting at "virtualPage" and "physicalPage", which are both
+// multiples of it.  In a page table, each page of a superpage still has
+// an entry of its own, with the same "superPages"; the kernel loads the
+// first one into the TLB to map them all.
 
 class TranslationEntry {
   public:
+    TranslationEntry() { superPages = 1; }
+
     int virtualPage;  	// The page number in virtual memory.
     int physicalPage;  	// The page number in real memory (relative to the
 			//  start of "mainMemory"
@@ -40,6 +48,8 @@ class TranslationEntry {
 			// page is referenced or modified.
     bool dirty;         // This bit is set by the hardware every time the
 			// page is modified.
+    int superPages;	// Number of pages mapped: 1, or the size of the
+			// superpage this page is part of.
 };
 
 #endif
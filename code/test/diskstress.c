@@ -0,0 +1,150 @@
+/* diskstress.c
+ *    Stress test for the disk cache.
+ *
+ *    Several processes, forked from this one, read the same files at
+ *    once, each in chunks of a different size that straddle sectors,
+ *    yielding after every chunk.  Each also reads back a file of its
+ *    own, written before forking and left dirty in the cache, after
+ *    the shared files have pushed it out.  Run it with a small -dc, so
+ *    that the cache is always full and sectors are evicted, written
+ *    back and read again while others wait for them (see
+ *    lab9/diskstress.sh).  The file system itself has no locking, so
+ *    only reads are done at once.
+ *
+ *    sort.noff and matmult.noff must be on the disk, as "sort" and
+ *    "matmult" (names there are at most 9 characters).  Every reader
+ *    prints "diskstress: reader N ok", or which check failed.
+ */
+
+#include "syscall.h"
+
+#define NumReaders	4	/* processes, counting this one */
+#define Rounds		3	/* times each reads the shared files */
+#define OwnBytes	2000	/* size of the file each writes */
+#define MaxChunk	300
+
+char *shared[2] = { "sort", "matmult" };
+int expected[2];		/* their checksums, read before forking */
+int reader;			/* which reader this process is */
+char name[] = "out0";		/* its own file */
+char buffer[MaxChunk];
+
+char okMessage[] = "diskstress: reader 0 ok\n";
+char message[] = "diskstress: reader 0 failed check 0\n";
+
+void
+Fail(int check)
+{
+    message[19] = '0' + reader;
+    message[34] = '0' + check;
+    Write(message, sizeof(message) - 1, ConsoleOutput);
+    Exit(check);
+}
+
+/* what byte "offset" of the current reader's file should hold */
+int
+Pattern(int offset)
+{
+    return 'a' + (reader * 7 + offset) % 26;
+}
+
+int
+Checksum(char *file, int chunk)
+{
+    OpenFileId id;
+    int sum = 0, n, i;
+
+    id = Open(file);
+    if (id < 0)
+	Fail(1);
+    while ((n = Read(buffer, chunk, id)) > 0) {
+	for (i = 0; i < n; i++)
+	    sum = sum * 31 + buffer[i];
+	Yield();
+    }
+    Close(id);
+    return sum;
+}
+
+int
+Chunk()
+{
+    return (reader % 3 + 1) * 100;	/* never a whole sector */
+}
+
+void
+WriteOwn(int chunk)
+{
+    OpenFileId id;
+    int offset, n, i;
+
+    name[3] = '0' + reader;
+    Create(name);
+    id = Open(name);
+    if (id < 0)
+	Fail(3);
+    for (offset = 0; offset < OwnBytes; offset += n) {
+	n = OwnBytes - offset < chunk ? OwnBytes - offset : chunk;
+	for (i = 0; i < n; i++)
+	    buffer[i] = Pattern(offset + i);
+	Write(buffer, n, id);
+	Yield();
+    }
+    Close(id);
+}
+
+void
+CheckOwn(int chunk)
+{
+    OpenFileId id;
+    int offset = 0, n, i;
+
+    name[3] = '0' + reader;
+    id = Open(name);
+    if (id < 0)
+	Fail(3);
+    while ((n = Read(buffer, chunk, id)) > 0) {
+	for (i = 0; i < n; i++)
+	    if (buffer[i] != Pattern(offset + i))
+		Fail(4);
+	offset += n;
+	Yield();
+    }
+    if (offset != OwnBytes)
+	Fail(5);
+    Close(id);
+}
+
+void
+Run()
+{
+    int chunk = Chunk();
+    int round, i, file;
+
+    for (round = 0; round < Rounds; round++)
+	for (i = 0; i < 2; i++) {
+	    file = (i + reader) % 2;	/* not all in the same order */
+	    if (Checksum(shared[file], chunk) != expected[file])
+		Fail(2);
+	}
+    CheckOwn(chunk);
+
+    okMessage[19] = '0' + reader;
+    Write(okMessage, sizeof(okMessage) - 1, ConsoleOutput);
+    Exit(0);
+}
+
+int
+main()
+{
+    for (reader = 0; reader < NumReaders; reader++)
+	WriteOwn(Chunk());
+    expected[0] = Checksum(shared[0], MaxChunk);
+    expected[1] = Checksum(shared[1], MaxChunk);
+
+    /* each child gets a copy of "reader" as it is when it is forked */
+    for (reader = 1; reader < NumReaders; reader++)
+	Fork(Run);
+    reader = 0;
+    Run();
+}
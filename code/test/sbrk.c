@@ -0,0 +1,92 @@
+/* sbrk.c
+ *    Test program for the heap and the stack.
+ *
+ *    Grows the heap with Sbrk and touches every byte of it, shrinks it
+ *    to the middle of a page and grows it again, checking that the
+ *    memory that comes back is zero, and checks that Sbrk refuses
+ *    what it can't give.  Then recurses deep enough that the stack
+ *    has to grow by many pages.
+ *
+ *    Prints "sbrk: ok", or which check failed, and exits with the
+ *    number of that check (0 if none).
+ */
+
+#include "syscall.h"
+
+#define HeapBytes	4096	/* what the heap is grown to */
+#define KeptBytes	100	/* what it is shrunk to: mid-page */
+#define Depth		32	/* levels of recursion, about 2K of stack */
+
+char message[] = "sbrk: check 00 failed\n";
+
+void
+Fail(int check)
+{
+    message[12] = '0' + check / 10;
+    message[13] = '0' + check % 10;
+    Write(message, sizeof(message) - 1, ConsoleOutput);
+    Exit(check);
+}
+
+int
+Recurse(int n)
+{
+    int local[8];		/* so each call takes some stack */
+    int i;
+
+    for (i = 0; i < 8; i++)
+	local[i] = n;
+    if (n == 0)
+	return 0;
+    return local[n % 8] + Recurse(n - 1);
+}
+
+int
+main()
+{
+    char *heap;
+    int i;
+
+    /* grow the heap, and touch all of it */
+    heap = Sbrk(HeapBytes);
+    if (heap == 0)
+	Fail(1);
+    for (i = 0; i < HeapBytes; i++) {
+	if (heap[i] != 0)
+	    Fail(2);
+	heap[i] = 'x';
+    }
+    for (i = 0; i < HeapBytes; i++)
+	if (heap[i] != 'x')
+	    Fail(3);
+
+    /* shrink it to the middle of a page, and grow it again */
+    if (Sbrk(KeptBytes - HeapBytes) != heap + HeapBytes)
+	Fail(4);
+    if (Sbrk(HeapBytes - KeptBytes) != heap + KeptBytes)
+	Fail(5);
+    for (i = 0; i < KeptBytes; i++)
+	if (heap[i] != 'x')
+	    Fail(6);
+    for (i = KeptBytes; i < HeapBytes; i++)
+	if (heap[i] != 0)
+	    Fail(7);
+
+    /* more than memory and swap hold, at the default sizes; more than
+     * the address space has room for; below the start of the heap */
+    if (Sbrk(60000) != 0)
+	Fail(8);
+    if (Sbrk(0x7fffffff) != 0)
+	Fail(9);
+    if (Sbrk(-0x7fffffff) != 0)
+	Fail(10);
+    if (Sbrk(0) != heap + HeapBytes)
+	Fail(11);
+
+    /* grow the stack */
+    if (Recurse(Depth) != Depth * (Depth + 1) / 2)
+	Fail(12);
+
+    Write("sbrk: ok\n", 9, ConsoleOutput);
+    Exit(0);
+}
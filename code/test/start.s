@@ -130,6 +130,16 @@ Yield:
 	j	$31
 	.end Yield
 
+#ifdef SC_Sbrk
+	.globl Sbrk
+	.ent	Sbrk
+Sbrk:
+	addiu $2,$0,SC_Sbrk
+	syscall
+	j	$31
+	.end Sbrk
+#endif
+
 /* dummy function to keep gcc happy */
         .globl  __main
         .ent    __main
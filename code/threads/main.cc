@@ -9,7 +9,10 @@
 // 	Most of this file is not needed until later assignments.
 //
 // Usage: nachos -d <debugflags> -rs <random seed #>
-//		-s -x <nachos file> -c <consoleIn> <consoleOut>
+//		-s -bb -prof -x <nachos file> -c <consoleIn> <consoleOut>
+//		-mem <frames> -pagesize <bytes>
+//		-tlb <entries> -tlbways <ways> -tlbpolicy <fifo|lru|clock>
+//		-superpages
 //		-f -cp <unix file> <nachos file>
 //		-p <nachos file> -r <nachos file> -l -D -t
 //              -n <network reliability> -e <network orderability>
@@ -23,9 +26,22 @@
 //
 //  USER_PROGRAM
 //    -s causes user programs to be executed in single-step mode
+//    -bb runs user programs a basic block at a time, checking for
+//	interrupts only between blocks
+//    -prof counts the instructions user programs execute, and prints
+//	the hottest PCs and the opcode mix when Nachos halts
+//    -mem sets the number of frames of physical memory (default 64)
+//    -pagesize sets the page size in bytes, a power of two, at least the
+//	disk sector size (the default)
 //    -x runs a user program
 //    -c tests the console
 //
+//  USE_TLB
+//    -tlb sets the number of TLB entries (4 to 256)
+//    -tlbways sets the TLB associativity (default fully associative)
+//    -tlbpolicy chooses the TLB replacement policy (default fifo)
+//    -superpages lets TLB entries map 4KB and 64KB superpages
+//
 //  FILESYS
 //    -f causes the physical disk to be formatted
 //    -cp copies a file from UNIX to Nachos
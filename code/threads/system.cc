@@ -64,6 +64,56 @@ TimerInterruptHandler(_int dummy)
 	interrupt->YieldOnReturn();
 }
 
+#ifdef USER_PROGRAM
+//----------------------------------------------------------------------
+// CheckMemorySize
+// 	Exit with a usage error unless -mem and -pagesize asked for sizes
+//	the kernel can run with: at least one frame, and a page size that
+//	is a power of two and a whole number of disk sectors.
+//----------------------------------------------------------------------
+
+static void
+CheckMemorySize()
+{
+    if (numPhysPages <= 0) {
+	fprintf(stderr, "nachos: -mem %d: need at least one frame\n",
+							numPhysPages);
+	Exit(1);
+    }
+    if (pageSize < SectorSize || (pageSize & (pageSize - 1)) != 0) {
+	fprintf(stderr, "nachos: -pagesize %d: must be a power of two, "
+	    "at least %d\n", pageSize, SectorSize);
+	Exit(1);
+    }
+}
+#endif
+
+#ifdef USE_TLB
+//----------------------------------------------------------------------
+// CheckTLBSize
+// 	Exit with a usage error unless -tlb and -tlbways describe a TLB
+//	that Machine::ConfigureTLB can build: MinTLBSize to MaxTLBSize
+//	entries, in sets whose size divides the number of entries.
+//
+//	"ways" -- entries per set, or 0 for fully associative
+//----------------------------------------------------------------------
+
+static void
+CheckTLBSize(int size, int ways)
+{
+    if (size < MinTLBSize || size > MaxTLBSize) {
+	fprintf(stderr, "nachos: -tlb %d: must be from %d to %d\n", size,
+						MinTLBSize, MaxTLBSize);
+	Exit(1);
+    }
+    if (ways < 0 || ways > size || (ways > 0 && size % ways != 0)) {
+	fprintf(stderr, "nachos: -tlbways %d: must divide the TLB size, "
+	    "%d\n", ways, size);
+	Exit(1);
+    }
+}
+#endif
+
 //----------------------------------------------------------------------
 // Initialize
 // 	Initialize Nachos global data structures.  Interpret command
@@ -83,6 +133,14 @@ Initialize(int argc, char **argv)
 
 #ifdef USER_PROGRAM
     bool debugUserProg = FALSE;	// single step user program
+    bool blockMode = FALSE;	// run user code a basic block at a time
+    bool profile = FALSE;	// count user instructions, print at halt
+#endif
+#ifdef USE_TLB
+    int tlbSize = TLBSize;	// number of TLB entries
+    int tlbWays = 0;		// entries per set; 0 => fully associative
+    TLBPolicy tlbPolicy = TLBFifo;	// TLB replacement policy
+    bool superPages = FALSE;	// let the TLB map superpages
 #endif
 #ifdef FILESYS_NEEDED
     bool format = FALSE;	// format disk
@@ -112,6 +170,47 @@ Initialize(int argc, char **argv)
 #ifdef USER_PROGRAM
 	if (!strcmp(*argv, "-s"))
 	    debugUserProg = TRUE;
+	else if (!strcmp(*argv, "-bb"))
+	    blockMode = TRUE;
+	else if (!strcmp(*argv, "-prof"))
+	    profile = TRUE;
+	else if (!strcmp(*argv, "-mem")) {
+	    ASSERT(argc > 1);
+	    numPhysPages = atoi(*(argv + 1));
+	    CheckMemorySize();
+	    argCount = 2;
+	} else if (!strcmp(*argv, "-pagesize")) {
+	    ASSERT(argc > 1);
+	    pageSize = atoi(*(argv + 1));
+	    CheckMemorySize();
+	    argCount = 2;
+	}
+#endif
+#ifdef USE_TLB
+	if (!strcmp(*argv, "-tlb")) {
+	    ASSERT(argc > 1);
+	    tlbSize = atoi(*(argv + 1));
+	    argCount = 2;
+	} else if (!strcmp(*argv, "-tlbways")) {
+	    ASSERT(argc > 1);
+	    tlbWays = atoi(*(argv + 1));
+	    argCount = 2;
+	} else if (!strcmp(*argv, "-tlbpolicy")) {
+	    ASSERT(argc > 1);
+	    if (!strcmp(*(argv + 1), "fifo"))
+		tlbPolicy = TLBFifo;
+	    else if (!strcmp(*(argv + 1), "lru"))
+		tlbPolicy = TLBLru;
+	    else if (!strcmp(*(argv + 1), "clock"))
+		tlbPolicy = TLBClock;
+	    else {
+		fprintf(stderr, "nachos: -tlbpolicy %s: must be fifo, lru "
+		    "or clock\n", *(argv + 1));
+		Exit(1);
+	    }
+	    argCount = 2;
+	} else if (!strcmp(*argv, "-superpages"))
+	    superPages = TRUE;
 #endif
 #ifdef FILESYS_NEEDED
 	if (!strcmp(*argv, "-f"))
@@ -133,6 +232,9 @@ Initialize(int argc, char **argv)
 	}
 #endif
     }
+#ifdef USE_TLB
+    CheckTLBSize(tlbSize, tlbWays);	// once both are known
+#endif
 
     DebugInit(debugArgs);			// initialize DEBUG messages
     stats = new Statistics();			// collect statistics
@@ -154,6 +256,15 @@ Initialize(int argc, char **argv)
     
 #ifdef USER_PROGRAM
     machine = new Machine(debugUserProg);	// this must come first
+    machine->SetBlockMode(blockMode);
+    if (profile)
+	machine->StartProfile();
+#endif
+#ifdef USE_TLB
+    machine->ConfigureTLB(tlbSize, (tlbWays > 0) ? tlbWays : tlbSize,
+								tlbPolicy);
+    if (superPages)
+	machine->EnableSuperPages();
 #endif
 
 #ifdef FILESYS
@@ -54,13 +54,19 @@ SwapHeader (NoffHeader *noffH)
 //	memory.  For now, this is really simple (1:1), since we are
 //	only uniprogramming, and we have a single unsegmented page table
 //
+//	Since virtual page # = physical page #, every aligned run of
+//	pages is also an aligned run of frames, so the address space is
+//	covered with the largest superpages the machine allows (if any),
+//	to make the most of the TLB.
+//
 //	"executable" is the file containing the object code to load into memory
 //----------------------------------------------------------------------
 
 AddrSpace::AddrSpace(OpenFile *executable)
 {
     NoffHeader noffH;
-    unsigned int i, size;
+    unsigned int i, j, size;
+    int pages;
 
     executable->ReadAt((char *)&noffH, sizeof(noffH), 0);
     if ((noffH.noffMagic != NOFFMAGIC) && 
@@ -75,7 +81,7 @@ AddrSpace::AddrSpace(OpenFile *executable)
     numPages = divRoundUp(size, PageSize);
     size = numPages * PageSize;
 
-    ASSERT(numPages <= NumPhysPages);		// check we're not trying
+    ASSERT(numPages <= (unsigned) NumPhysPages);	// check we're not trying
 						// to run anything too big --
 						// at least until we have
 						// virtual memory
@@ -94,6 +100,11 @@ AddrSpace::AddrSpace(OpenFile *executable)
 					// a separate page, we could set its 
 					// pages to be read-only
     }
+    for (i = 0; i < numPages; i += pages) {
+	pages = machine->SuperPageSize(i, numPages - i);
+	for (j = i; j < i + pages; j++)
+	    pageTable[j].superPages = pages;
+    }
     
 // zero out the entire address space, to zero the unitialized data segment 
 // and the stack segment
@@ -166,21 +177,53 @@ AddrSpace::InitRegisters()
 //----------------------------------------------------------------------
 
 void AddrSpace::SaveState() 
-{}
+{
+#ifdef USE_TLB
+    machine->FlushTLB();	// the next space's pages share the TLB
+#endif
+}
 
 //----------------------------------------------------------------------
 // AddrSpace::RestoreState
 // 	On a context switch, restore the machine state so that
 //	this address space can run.
 //
-//      For now, tell the machine where to find the page table.
+//      For now, tell the machine where to find the page table.  With
+//	a TLB, the page table is only consulted on a TLB miss, and the
+//	TLB starts out empty.
 //----------------------------------------------------------------------
 
 void AddrSpace::RestoreState() 
 {
+#ifdef USE_TLB
+    machine->FlushTLB();
+#else
     machine->pageTable = pageTable;
     machine->pageTableSize = numPages;
+    machine->FlushHostTLB();
+#endif
+}
+
+#ifdef USE_TLB
+//----------------------------------------------------------------------
+// AddrSpace::LoadTLB
+// 	Handle a TLB miss at "badVAddr" by loading the page table entry
+//	for its page into the TLB -- or if the page is part of a
+//	superpage, the entry for the superpage's first page, which maps
+//	all of it.  Returns FALSE if the address is outside the address
+//	space.
+//----------------------------------------------------------------------
+
+bool AddrSpace::LoadTLB(int badVAddr)
+{
+    unsigned int vpn = (unsigned) badVAddr / PageSize;
+
+    if (vpn >= numPages || !pageTable[vpn].valid)
+	return FALSE;
+    machine->LoadTLB(&pageTable[vpn - vpn % pageTable[vpn].superPages]);
+    return TRUE;
 }
+#endif
 
 void AddrSpace::Print() {
     printf("page table dump: %d pages in total\n", numPages); 
@@ -30,6 +30,11 @@ class AddrSpace {
 
     void SaveState();			// Save/restore address space-specific
     void RestoreState();		// info on a context switch 
+#ifdef USE_TLB
+    bool LoadTLB(int badVAddr);		// Load the translation for
+					// "badVAddr" into the TLB after a
+					// miss; FALSE if it is unmapped
+#endif
 
     void Print();
 
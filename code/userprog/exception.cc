@@ -56,6 +56,11 @@ ExceptionHandler(ExceptionType which)
     if ((which == SyscallException) && (type == SC_Halt)) {
 	DEBUG('a', "Shutdown, initiated by user program.\n");
    	interrupt->Halt();
+#ifdef USE_TLB
+    } else if ((which == PageFaultException) &&
+		currentThread->space->LoadTLB(machine->ReadRegister(BadVAddrReg))) {
+	return;		// retry the instruction, now that it's in the TLB
+#endif
     } else {
 	printf("Unexpected user mode exception %d %d\n", which, type);
 	ASSERT(FALSE);